@@ -561,6 +561,57 @@ AC_DEFUN([AC_USE_READLINE],
   fi
 ])
 dnl --------------------------------------------------------------------------
+dnl @synopsis AC_USE_THREADS
+dnl
+dnl See whether we can use POSIX threads, and what libraries are needed
+dnl
+dnl @author Richard Smith <richard@ex-parrot.com>
+dnl
+AC_DEFUN([AC_USE_THREADS],
+ [AC_ARG_WITH(
+    threads,
+    AC_HELP_STRING([--without-threads], [do not use multiple threads]),
+    ac_cv_use_threads=$withval
+  )
+  if test "$ac_cv_use_threads" != no; then
+    AC_CACHE_CHECK(
+      [what libraries are needed for POSIX threads],
+      [ac_cv_thread_libs],
+      [AC_LANG_PUSH(C++)
+       ac_check_cxx_lib_save_LIBS="$LIBS"
+       ac_cv_thread_libs=no
+       for library in "" -lpthread -pthread; do
+	 if test "$ac_cv_thread_libs" = no; then
+	   LIBS="$ac_check_cxx_lib_save_LIBS $library"
+	   AC_LINK_IFELSE(
+             [AC_LANG_PROGRAM(
+               [#include <pthread.h>
+                extern "C" void* fn(void*) { return 0; }
+               ], 
+               [pthread_t t; pthread_create(&t, 0, &fn, 0);
+                pthread_join(t, 0);])],
+             ac_cv_thread_libs="${library:-none required}")
+	 fi
+       done
+       LIBS="$ac_check_cxx_lib_save_LIBS"
+       AC_LANG_POP(C++)])
+    if test "$ac_cv_thread_libs" = no; then
+      ac_cv_use_threads=no
+    fi
+  fi
+  if test "$ac_cv_use_threads" != no; then
+    USE_THREADS=1
+    if test "$ac_cv_thread_libs" = "none required"; then
+      THREAD_LIBS=
+    else
+      THREAD_LIBS="$ac_cv_thread_libs"
+    fi
+  else
+    USE_THREADS=0
+    THREAD_LIBS=
+  fi
+])
+dnl --------------------------------------------------------------------------
 dnl @synopsis AC_USE_XERCES
 dnl
 dnl See whether we've got the Apache Xerces library installed
@@ -1,5 +1,5 @@
 // -*- C++ -*- extent.cpp - utility print an extent 
-// Copyright (C) 2007, 2011 Richard Smith <richard@ex-parrot.com>
+// Copyright (C) 2007, 2011, 2014 Richard Smith <richard@ex-parrot.com>
 
 // This program is free software; you can redistribute it and/or modify
 // it under the terms of the GNU General Public License as published by
@@ -29,10 +29,15 @@
 #endif
 
 #if RINGING_OLD_INCLUDES
+#include <algo.h>
 #include <iterator.h>
+#include <vector.h>
 #else
+#include <algorithm>
 #include <iterator>
+#include <vector>
 #endif
+#include <string>
 
 #include "args.h"
 #include "init_val.h"
@@ -47,6 +52,8 @@ struct arguments
   init_val<int,0> tenors; // nt-nw-nh
 
   init_val<bool,false> in_course;
+  init_val<bool,false> plain_changes;
+  init_val<bool,false> changes;
 
   void bind( arg_parser& p );
   bool validate( arg_parser& p );
@@ -76,6 +83,19 @@ void arguments::bind( arg_parser& p )
          ( 'i', "in-course",
 	   "Only list in-course rows",
            in_course ) );
+
+  p.add( new boolean_opt
+         ( 'p', "plain-changes",
+	   "List the rows in plain changes order, so that each differs "
+           "from the previous one by a single swap, rather than in "
+           "lexicographical order",
+           plain_changes ) );
+
+  p.add( new boolean_opt
+         ( 'c', "changes",
+	   "List the changes needed to ring the extent by plain changes, "
+           "starting and finishing in rounds, rather than the rows",
+           changes ) );
 }
 
 bool arguments::validate( arg_parser& ap )
@@ -94,9 +114,75 @@ bool arguments::validate( arg_parser& ap )
       return false;
     }
 
+  if ( changes && in_course ) 
+    {
+      ap.error( "The --changes and --in-course options are incompatible" );
+      return false;
+    }
+
   return true;
 }
 
+// Output is written through a large buffer, as otherwise writing to
+// cout one row at a time is much slower than generating the rows.
+class output_buffer
+{
+public:
+  output_buffer() { buf.reserve( limit + 64 ); }
+ ~output_buffer() { flush(); }
+
+  void append( string const& s ) 
+    { buf.append(s); if ( buf.size() >= limit ) flush(); }
+
+  void flush() 
+    { cout.write( buf.data(), buf.size() ); buf.clear(); }
+
+private:
+  enum { limit = 1 << 16 };
+  string buf;
+};
+
+void print_lexicographical( arguments const& args, unsigned nw, 
+                            unsigned nh, unsigned nt )
+{
+  output_buffer out;
+  if ( args.in_course )
+    for ( incourse_extent_iterator i(nw, nh, nt), e; i != e; ++i )
+      out.append( i->print() + '\n' );
+  else 
+    for ( extent_iterator i(nw, nh, nt), e; i != e; ++i )
+      out.append( i->print() + '\n' );
+}
+
+void print_plain_changes( arguments const& args, unsigned nw, 
+                          unsigned nh, unsigned nt )
+{
+  // Successive rows differ by a single swap, so rather than printing
+  // each row, the swap is made to the previous row's text.
+  output_buffer out;
+  string line( row(nt).print() + '\n' );
+  bool even = true;
+  for ( plain_changes_iterator i(nw, nh, nt), e; i != e; ++i ) {
+    if ( even || !args.in_course ) 
+      out.append( line );
+    if ( nw > 1 ) 
+      swap( line[ i.swap_position() ], line[ i.swap_position() + 1 ] );
+    even = !even;
+  }
+}
+
+void print_changes( unsigned nw, unsigned nh, unsigned nt )
+{
+  // There are only nw-1 distinct changes, so print them all in advance
+  vector<string> pn( nw > 1 ? nw-1 : 1 );
+  output_buffer out;
+  for ( plain_changes_iterator i(nw, nh, nt), e; i != e; ++i ) {
+    string& s = pn[ nw > 1 ? i.swap_position() - nh : 0 ];
+    if ( s.empty() ) s = i.next_change().print() + '\n';
+    out.append( s );
+  }
+}
+
 int main( int argc, char *argv[] )
 {
   bell::set_symbols_from_env();
@@ -120,8 +206,10 @@ int main( int argc, char *argv[] )
   const unsigned int nw = args.bells - args.tenors - args.hunts;
   const unsigned int nh = args.hunts, nt = args.bells;
 
-  for ( extent_iterator i(nw, nh, nt), e; i != e; ++i ) {
-    if ( !args.in_course || i->sign() > 0 )
-      cout << *i << "\n";
-  }
+  if ( args.changes )
+    print_changes( nw, nh, nt );
+  else if ( args.plain_changes )
+    print_plain_changes( args, nw, nh, nt );
+  else
+    print_lexicographical( args, nw, nh, nt );
 }
@@ -658,11 +658,10 @@ void state::init_mt( method const& m, group const& pgrp,
     postgroup = group( m.lh() );
 
   if ( flags & in_course_only )
-    mt.reset( new multtab( incourse_extent_iterator(nw, nh, bells),
-			   incourse_extent_iterator(), pgrp, postgroup ) );
+    mt.reset( new multtab( incourse_extent(nw, nh, bells), 
+                           pgrp, postgroup ) );
   else
-    mt.reset( new multtab( extent_iterator(nw, nh, bells),
-			   extent_iterator(), pgrp, postgroup ) );
+    mt.reset( new multtab( ringing::extent(nw, nh, bells), pgrp, postgroup ) );
 
   assert( mt->size() * pgrp.size() 
 	  == factorial(nw) / ( (flags & in_course_only) ? 2 : 1 ) );
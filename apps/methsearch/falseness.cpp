@@ -34,20 +34,48 @@
 #endif
 #if RINGING_OLD_C_INCLUDES
 #include <assert.h>
+#include <string.h>
 #else
 #include <cassert>
+#include <cstring>
 #endif
 #include <ringing/row.h>
+#include <ringing/change.h>
 #include <ringing/falseness.h>
+#include <ringing/falseness_cache.h>
+#include <ringing/falseness_graph.h>
 
 
 RINGING_USING_NAMESPACE
 RINGING_USING_STD
 
+RINGING_START_ANON_NAMESPACE
+
+// Only set if --falseness-cache is used
+scoped_pointer<falseness_cache> cache;
+
+false_courses get_false_courses( const method &m, int flags )
+{
+  return cache ? cache->courses( m, flags ) : false_courses( m, flags );
+}
+
+falseness_table get_falseness_table( const method &m, int flags )
+{
+  return cache ? cache->table( m, flags ) : falseness_table( m, flags );
+}
+
+RINGING_END_ANON_NAMESPACE
+
+void use_falseness_cache( const string &filename )
+{
+  cache.reset( new falseness_cache( filename ) );
+}
+
 string falseness_group_codes( const method &m )
 {
-  return false_courses
-    ( m, m.bells() == 8 ? 0 : false_courses::tenors_together ).symbols();
+  int const flags = m.bells() == 8 ? 0 : false_courses::tenors_together;
+  return cache ? cache->symbols( m, flags )
+               : false_courses( m, flags ).symbols();
 }
 
 
@@ -64,64 +92,30 @@ string falseness_group_codes( const method &m )
 // to be possible using an arbitrary number of single-change lead end calls,
 // the graph must be bipartite.
 // 
-class falseness_analysis
-{
-private:
-  friend bool might_support_extent( const method &m );
-  friend bool might_support_positive_extent( const method &m );
-
-  falseness_analysis( const method &m, bool in_course_only )
-    : ft(m, in_course_only ? falseness_table::in_course_only : 0) 
-  {    
-  }
-  
-  bool recurse( const row &r, int sign )
-  {
-    map< row, int >::iterator si = signs.find(r);
-
-    if ( si == signs.end() )
-      {
-	signs[r] = sign;
-
-	for( falseness_table::const_iterator i( ft.begin() ), e( ft.end() );
-	     i != e; ++i )
-	  {
-	    if ( !i->isrounds() )
-	      if ( !recurse( r * *i, -sign ) )
-		return false;
-	  }
-
-	return true;
-      }
-
-    return si->second == sign;
-  }
-
-
-  falseness_table ft;
-  map< row, int > signs;
-};
-
 bool might_support_positive_extent( const method &m )
 {
-  return falseness_analysis(m, true).recurse( row( m.bells() ), +1 ); 
+  return falseness_graph
+    ( get_falseness_table( m, falseness_table::in_course_only ) )
+    .is_bipartite();
 }
 
 bool might_support_extent( const method &m )
 {
   assert( m.isplain() ); 
-  return falseness_analysis(m, false).recurse( row( m.bells() ), +1 ); 
+  return falseness_graph( get_falseness_table( m, 0 ) ).is_bipartite();
 }
 
 bool is_cps( const method &m )
 {
   if ( m.bells() >= 8 ) {
-    const false_courses fchs( m, false_courses::in_course_only 
-			      |  false_courses::tenors_together );
+    const false_courses fchs
+      ( get_false_courses( m, false_courses::in_course_only 
+                              | false_courses::tenors_together ) );
   
     return fchs.size() == 1;
   } else { 
-    const false_courses fchs( m, false_courses::in_course_only );
+    const false_courses fchs
+      ( get_false_courses( m, false_courses::in_course_only ) );
     if ( m.back().sign() == +1 )
       return fchs.size() == 2;
     else      
@@ -129,3 +123,63 @@ bool is_cps( const method &m )
   }
 }
 
+falseness_tracker::falseness_tracker( int bells, size_t lead_len, bool sym,
+                                      string const& allowed, 
+                                      bool require_cps )
+  : lead_len(lead_len), sym(sym), allowed(allowed), require_cps(require_cps),
+    rows( 1, row(bells) ), posns( 1, 0 )
+{
+}
+
+bool falseness_tracker::push( change const& ch )
+{
+  rows.push_back( rows.back() * ch );
+  posns.push_back( rows.back().find(0) );
+
+  size_t const d = rows.size() - 1;
+  if ( d >= ( sym ? lead_len/2 : lead_len ) )
+    return true;
+
+  // If the lead contains rows a and b, it is false against the lead 
+  // starting from a b^-1.
+  for ( size_t i = 0; i < d; ++i )
+    if ( posns[i] == posns[d] && !is_acceptable( rows[d] / rows[i] ) )
+      return false;
+
+  return true;
+}
+
+void falseness_tracker::truncate( size_t n )
+{
+  if ( rows.size() > n+1 ) {
+    rows.resize( n+1 );
+    posns.resize( n+1 );
+  }
+}
+
+bool falseness_tracker::is_acceptable( row const& x )
+{
+  map<row, bool>::const_iterator i = verdicts.find(x);
+  if ( i != verdicts.end() ) 
+    return i->second;
+
+  // Don't let the memo grow without bound on large numbers of bells
+  if ( verdicts.size() > 1000000 )
+    verdicts.clear();
+
+  assert( x[0] == 0 );
+  string const sym( false_courses::lookup_symbol(x) );
+  assert( x.bells() != 8 || sym.size() );
+
+  bool ok = true;
+  if ( allowed.size() && sym != "A" && sym.size() 
+       && allowed.find(sym) == string::npos ) 
+    ok = false;
+  else if ( require_cps )
+    ok = sym.empty() || strchr("AabcdefXYZ", sym[0]) ||
+         sym[1] == '2' && strchr("BCDEFHKNOT", sym[0]) ||
+         sym[1] == '3' && strchr("KN", sym[0]);
+
+  verdicts[x] = ok;
+  return ok;
+}
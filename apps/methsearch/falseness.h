@@ -27,17 +27,24 @@
 #endif
 
 #include <ringing/pointers.h>
+#include <ringing/row.h>
 #include <string>
+#include <vector>
+#include <map>
 
 // Forward declare ringing::method
 RINGING_START_NAMESPACE
 class method;
-class row;
+class change;
 RINGING_END_NAMESPACE
 
 RINGING_USING_NAMESPACE
 RINGING_USING_STD
 
+// Keep the falseness of the methods found in the named file, and use
+// it instead of recalculating it in future runs.
+void use_falseness_cache( const string &filename );
+
 string falseness_group_codes( const method &m );
 
 bool might_support_positive_extent( const method &m );
@@ -45,4 +52,39 @@ bool might_support_extent( const method &m );
 
 bool is_cps( const method &m );
 
+// Keeps track of the falseness groups in a partially constructed lead of 
+// a regular single-hunt method, so that the search can be pruned as soon 
+// as a falseness group that is not wanted appears.  Each new row is 
+// compared against the earlier rows with the treble in the same place.
+// For a symmetric method, only the first half-lead need be considered
+// as every other pair of rows gives the same falseness group.
+class falseness_tracker
+{
+public:
+  falseness_tracker( int bells, size_t lead_len, bool sym,
+                     string const& allowed, bool require_cps );
+
+  // Add the row reached by ringing ch.  Returns false if this makes 
+  // the lead contain an unwanted falseness group.  The row is added 
+  // either way.
+  bool push( change const& ch );
+
+  // Remove all but the rows reached by the first n changes
+  void truncate( size_t n );
+
+  void set_lead_length( size_t len ) { lead_len = len; }
+
+private:
+  bool is_acceptable( row const& x );
+
+  size_t lead_len;
+  bool sym;
+  string allowed;
+  bool require_cps;
+
+  vector<row> rows;
+  vector<int> posns;        // The place of the treble in each row
+  map<row, bool> verdicts;  // Memoised results of is_acceptable
+};
+
 #endif // METHSEARCH_FALSENESS_INCLUDED
@@ -21,12 +21,14 @@
 #include <ringing/common.h>
 #include <ringing/falseness.h>
 #include "libraries.h"
+#include "falseness.h"
 #include "music.h"
 #include "format.h"
 #include "search.h"
 #include "prog_args.h"
 #include <ctime>
 #include <cstdlib>
+#include <iostream>
 
 
 RINGING_USING_NAMESPACE
@@ -51,6 +53,14 @@ int main( int argc, char *argv[] )
   if ( formats_have_falseness_groups() )
     false_courses::optimise( args.bells );
 
+  if ( !args.falseness_cache.empty() )
+    try {
+      use_falseness_cache( args.falseness_cache );
+    } catch ( const exception& e ) {
+      cerr << argv[0] << ": " << e.what() << endl;
+      return 1;
+    }
+
   run_search( args );
 
   return 0;
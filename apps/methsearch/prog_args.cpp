@@ -484,6 +484,11 @@ void arguments::bind( arg_parser &p )
 	   "Check for falseness", "TYPE",
 	   *this ) );
 
+  p.add( new string_opt
+	 ( '\0', "falseness-cache",
+	   "Cache the falseness of methods in FILENAME", "FILENAME",
+	   falseness_cache ) );
+
   p.add( new string_opt
 	 ( 'm', "mask",
 	   "Require that the method matches the given mask", "PATTERN",
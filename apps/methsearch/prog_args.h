@@ -124,6 +124,7 @@ struct arguments
   init_val<bool,false> true_extent;
   init_val<bool,false> true_positive_extent;
   string               allowed_falseness; 
+  string               falseness_cache;
 
   row                  start_row;
   vector<row>          pends_generators;
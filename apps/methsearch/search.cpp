@@ -103,7 +103,6 @@ private:
   void output_method( method const& meth );
 
   bool is_acceptable_leadhead( const row &lh );
-  bool is_falseness_acceptable( const change& ch );
 
 private:
   const arguments &args; 
@@ -129,6 +128,7 @@ private:
   bool maintain_r;   // Whether r is valid
   row r;
   scoped_pointer<prover> prv;
+  scoped_pointer<falseness_tracker> ftracker;
   time_t start;
 };
 
@@ -176,6 +176,14 @@ void searcher::reset()
     maintain_r = true;
   }
 
+  // The falseness groups can only be checked as the lead is built for
+  // single-hunt treble-dodging methods.
+  if ( ( args.allowed_falseness.size() || args.require_CPS ) 
+       && args.hunt_bells == 1 && args.treble_dodges )
+    ftracker.reset( new falseness_tracker( bells, lead_len, args.sym,
+                                           args.allowed_falseness,
+                                           args.require_CPS ) );
+
   start = time(NULL);
 }
 
@@ -194,8 +202,10 @@ void searcher::filter( library const& in )
     {
       try {
         filter_method = i->meth();
-        if ( !args.lead_len )
+        if ( !args.lead_len ) {
           lead_len = filter_method.length();
+          if ( ftracker ) ftracker->set_lead_length( lead_len );
+        }
         if ( i->has_facet<litelib::payload>() )
           filter_payload = i->get_facet<litelib::payload>();
         else
@@ -568,12 +578,16 @@ inline bool searcher::push_change( const change& ch )
     div_start += cur_div_len;
     cur_div_len = calc_cur_div_len();
   }
+  if ( ftracker && !ftracker->push(ch) )
+    return false;
   return true;
 }
 
 inline void searcher::pop_change( row const* r_old )
 {
   m.pop_back();
+  if ( ftracker ) 
+    ftracker->truncate( m.size() );
   if (div_start > m.length()) {
      div_start -= cur_div_len;
      cur_div_len = calc_cur_div_len();
@@ -998,43 +1012,9 @@ cerr << "SOUP: " << ch << " at depth " << m.length() << endl;
        && division_bad_parity_hack( m, ch, div_start, cur_div_len ) )
     return false;
 
-  if ( ( args.allowed_falseness.size() || args.require_CPS ) 
-       && depth - div_start >= 1 && depth - div_start != cur_div_len - 1
-       && ! is_falseness_acceptable( ch ) )
-    return false;
-
   return true;
 }
 
-bool searcher::is_falseness_acceptable( const change& ch )
-{
-  row r( args.bells ); for_each( m.begin(), m.end() - 1, permute(r) );
-  row c; c *= m.back(); c *= ch;
-
-  // 1 contains 1.r and 1.r.c
-  // x contains 1.r.c and 1.r.c.c
-  // so x.r = 1.r.c  =>  x = r.c.r^{-1}
-
-  row x = r * c * r.inverse();
-
-  assert( x[0] == 0 );
-  string sym( false_courses::lookup_symbol(x) );
-  assert( args.bells != 8 || sym.size() );
-  if ( args.allowed_falseness.size() ) {
-    if ( sym == "A" || sym.empty() ) return true;
-    if ( args.allowed_falseness.find(sym) == string::npos ) return false;
-  } 
-  if ( args.require_CPS ) {
-    if ( sym.empty() || strchr("AabcdefXYZ", sym[0]) ||
-         sym[1] == '2' && strchr("BCDEFHKNOT", sym[0]) ||
-         sym[1] == '3' && strchr("KN", sym[0])  )
-      return true;
-    else return false;
-  }
-  return true;
-}
-
-
 bool searcher::try_quarterlead_change( const change &ch )
 {
   assert( lead_len % 2 == 0 );
@@ -22,6 +22,7 @@
 
 #include <ringing/extent.h>
 #include <ringing/falseness.h>
+#include <ringing/falseness_cache.h>
 #include <ringing/group.h>
 #include <ringing/iteratorutils.h>
 #include <ringing/litelib.h>
@@ -241,6 +242,7 @@ struct arguments
   group                pends;
 
   string               write_plan;
+  string               falseness_cache;
 
   arguments( int argc, char const* argv[] );
 
@@ -304,6 +306,11 @@ void arguments::bind( arg_parser& p )
          ( 'O', "output-plans",
            "Write plans out to directory or file (with % for the plan number)",
            "FILE", write_plan ) );
+
+  p.add( new string_opt
+         ( '\0', "falseness-cache",
+           "Cache the falseness between methods in FILE", "FILE",
+           falseness_cache ) );
 }
 
 bool arguments::validate( arg_parser& ap )
@@ -435,9 +442,15 @@ void searcher::init_pends()
 void searcher::init_falseness()  
 {
   int ftflags = 0 | (args.in_course ? falseness_table::in_course_only : 0);
+
+  scoped_pointer<falseness_cache> cache;
+  if ( !args.falseness_cache.empty() )
+    cache.reset( new falseness_cache( args.falseness_cache ) );
+
   for ( method_ptr i=meths.begin(), e=meths.end(); i != e; ++i )
   for ( method_ptr j=meths.begin()               ; j != e; ++j ) {
-    falseness_table ft(i->meth, j->meth, ftflags);
+    falseness_table ft( cache ? cache->table(i->meth, j->meth, ftflags)
+                              : falseness_table(i->meth, j->meth, ftflags) );
     vector<row_t> ft2;
     for ( falseness_table::const_iterator fi=ft.begin(), fe=ft.end();
           fi != fe; ++fi )
@@ -1,5 +1,5 @@
 // -*- C++ -*- splices.cpp - utility to find splices between methods
-// Copyright (C) 2010, 2011 Richard Smith <richard@ex-parrot.com>
+// Copyright (C) 2010, 2011, 2014 Richard Smith <richard@ex-parrot.com>
 
 // This program is free software; you can redistribute it and/or modify
 // it under the terms of the GNU General Public License as published by
@@ -25,12 +25,16 @@
 #include <ringing/litelib.h>
 #include <ringing/group.h>
 #include <ringing/falseness.h>
+#include <ringing/falseness_graph.h>
+#include <ringing/parallel.h>
 #include "args.h"
 
 #include <iostream>
 #include <list>
 #include <set>
 #include <map>
+#include <vector>
+#include <algorithm>
 #include <utility>
 
 RINGING_USING_NAMESPACE
@@ -254,17 +258,26 @@ bool arguments::validate( arg_parser& ap )
 
 class splices {
 public:
-  splices( arguments const& args ) : args(args) {}
+  splices( arguments const& args ) 
+    : args(args), matrix( falseness_flags(args) ) {}
 
   void find_splices( library const& lib );
 
 private:
   static string name_or_pn( arguments const& args, method const& m );
+  static int falseness_flags( arguments const& args );
   class sort_function;
+  class pair_tester;
+  friend class pair_tester;
+  struct pending_method;
 
   bool test_splice( method const& a, method const& b );
   string test_splice( method const& a, vector<row> const& b, 
                       string const& b_name = string() );
+  string analyse_splice( falseness_table const& ft, ostream& os ) const;
+  void print_splice( method const& a, string const& b_name, 
+                     string const& desc ) const;
+  void test_pending();
   bell get_pivot( group const& sg ) const;
   pair<bell, bell> get_swapping_pair( group const& sg ) const;
   string describe_splice( group const& sg ) const;
@@ -274,11 +287,33 @@ private:
   void print_set( set<method> const& s ) const;
   set<method, sort_function> get_lead_splices( method const& m ) const;
   static method get_method( library_entry const& e );
+  static string filter_line( library_entry const& e );
   bool has_lead_splices( method const& m ) const;
 
-  typedef list< pair< string, set<method> > > table_type;
-  table_type table;
+  // Splices saved for grouping.  The vertices are pairs of a description
+  // of a splice and a method, so that each cluster contains methods that
+  // splice in the same way.
+  typedef pair< string, method > splice_vertex;
+  size_t vertex_index( string const& d, method const& m );
+  map< splice_vertex, size_t > vertex_ids;
+  vector< splice_vertex > vertices;
+  splice_clusters clusters;
+
   arguments const& args;
+
+  // When looking for splices between all pairs of methods, the methods 
+  // are read in batches of the matrix's tile size.
+  falseness_matrix matrix;
+  vector<method> meths;
+  vector<bool> duplicate;       // Is meths[i] the same as an earlier one?
+  set<method> distinct;
+  vector<pending_method> pending;
+};
+
+struct splices::pending_method 
+{
+  method meth;           // As read from the library, without a name
+  string filter_line;    // What to output if it passes the filter
 };
 
 string splices::name_or_pn( arguments const& args, method const& m )
@@ -332,14 +367,14 @@ set<method, splices::sort_function>
 {
   set<method, sort_function> ls(( sort_function(args) ));
 
-  for ( table_type::const_iterator i=table.begin(), e=table.end(); i!=e; ++i )
-    if ( i->first == "1-lead" && i->second.find(m) != i->second.end() ) {
-      for ( set<method>::const_iterator 
-              i2=i->second.begin(), e2=i->second.end(); i2 != e2; ++i2 )
-        if ( i2->back() == m.back() )
-          ls.insert(*i2);
-      break;
-    }
+  map< splice_vertex, size_t >::const_iterator 
+    v = vertex_ids.find( make_pair( string("1-lead"), m ) );
+  if ( v != vertex_ids.end() ) {
+    vector<size_t> const c( clusters.cluster( v->second ) );
+    for ( vector<size_t>::const_iterator i=c.begin(), e=c.end(); i!=e; ++i )
+      if ( vertices[*i].second.back() == m.back() )
+        ls.insert( vertices[*i].second );
+  }
 
   if (ls.size() == 1) ls.clear();
 
@@ -378,29 +413,35 @@ void splices::print_set( set<method> const& s ) const
 
 bool splices::has_lead_splices( method const& m ) const
 {
-  for ( table_type::const_iterator i=table.begin(), e=table.end(); i!=e; ++i )
-    if ( i->first == "1-lead" && i->second.find(m) != i->second.end() )
-      return true;
-  return false;
+  return vertex_ids.find( make_pair( string("1-lead"), m ) ) 
+    != vertex_ids.end();
 }
 
 void splices::print_splice_groups() const
 {
-  for ( table_type::const_iterator i=table.begin(), e=table.end(); i!=e; ++i )
+  vector< vector<size_t> > const cs( clusters.clusters() );
+  for ( vector< vector<size_t> >::const_iterator c=cs.begin(), ce=cs.end(); 
+        c!=ce; ++c )
   {
+    string const& desc = vertices[ c->front() ].first;
+    set<method> meths;
+    for ( vector<size_t>::const_iterator j=c->begin(), je=c->end(); 
+          j!=je; ++j )
+      meths.insert( vertices[*j].second );
+
     // We've got spurious lead splice entries here to enable bracketing
     // of lead splices within other types of splice.
-    if ( args.only_n_leads > 1 && i->first == "1-lead" )
+    if ( args.only_n_leads > 1 && desc == "1-lead" )
       continue;
 
     // If we're running with -ge, we want to group methods by their lead-end.
     if ( args.same_le ) {
-      if ( is_just_le_vars(i->second) )
+      if ( is_just_le_vars(meths) )
         continue;
 
       map< change, set<method> > by_le;
       for ( set<method>::const_iterator
-            i2=i->second.begin(), e2=i->second.end(); i2 != e2; ++i2 )
+            i2=meths.begin(), e2=meths.end(); i2 != e2; ++i2 )
         by_le[ i2->back() ].insert( *i2 );
  
       bool need_sep = false;
@@ -412,50 +453,35 @@ void splices::print_splice_groups() const
       }
     }
     else 
-      print_set( i->second );
+      print_set( meths );
 
-    cout << "\t" << i->first << "\n";
+    cout << "\t" << desc << "\n";
   }
 }
 
-void splices::save_splice( method const& a, method const& b, string const& d )
+size_t splices::vertex_index( string const& d, method const& m )
 {
-  table_type::iterator found = table.end();
-  for ( table_type::iterator i=table.begin(), e=table.end(); i!=e;  )
-    if ( d == i->first && 
-         ( i->second.find(a) != i->second.end() ||
-           i->second.find(b) != i->second.end() ) ) 
-    {
-      if ( found == e ) {
-        i->second.insert(a);
-        i->second.insert(b); 
-        found = i++;
-      }
-      else {
-        // It's possible that a is part of one set and b is part of another.
-        // If so, we need to merge them.  This can happen if some of the 
-        // splices between set members are more specific and thus not 
-        // shown.  We'll have already inserted a,b into found so no need
-        // to do again.
-        found->second.insert( i->second.begin(), i->second.end() );
-        table.erase(i++);
-      }
-    }
-    else ++i;
+  pair< map< splice_vertex, size_t >::iterator, bool > const i
+    = vertex_ids.insert( make_pair( make_pair(d, m), vertices.size() ) );
+  if ( i.second )
+    vertices.push_back( i.first->first );
+  return i.first->second;
+}
 
-  if ( found == table.end() ) {
-    set<method> meths;
-    meths.insert(a);  meths.insert(b);
-    table.push_back( make_pair( d, meths ) );
-  }
+void splices::save_splice( method const& a, method const& b, string const& d )
+{
+  clusters.join( vertex_index(d, a), vertex_index(d, b) );
 }
 
+// A bell is fixed by every element of the group if and only if it is
+// fixed by every generator, so there is no need to enumerate the group.
 bell splices::get_pivot( group const& sg ) const
 {
   const int hunts = 1;
   for ( int b=hunts; b<sg.bells(); ++b ) {
     bool fixed = true;
-    for ( group::const_iterator i=sg.begin(), e=sg.end(); fixed && i!=e; ++i )
+    for ( vector<row>::const_iterator i=sg.generators().begin(), 
+            e=sg.generators().end(); fixed && i!=e; ++i )
       if ( (*i)[b] != b )
         fixed = false;
     if (fixed) return bell(b);
@@ -470,7 +496,8 @@ pair<bell, bell> splices::get_swapping_pair( group const& sg ) const
   for ( int b1=hunts; b1<sg.bells(); ++b1 ) 
   for ( int b2=b1+1;  b2<sg.bells(); ++b2 ) {
     bool fixed = true;
-    for ( group::const_iterator i=sg.begin(), e=sg.end(); fixed && i!=e; ++i )
+    for ( vector<row>::const_iterator i=sg.generators().begin(), 
+            e=sg.generators().end(); fixed && i!=e; ++i )
       if ( !( (*i)[b1] == b1 && (*i)[b2] == b2 ) &&
            !( (*i)[b1] == b2 && (*i)[b2] == b1 ) )
         fixed = false;
@@ -502,32 +529,44 @@ string splices::describe_splice( group const& sg ) const
   return os;
 }
 
-string splices::test_splice( method const& a, vector<row> const& b,
-                             string const& b_name )
-{ 
-  size_t max_size = factorial(args.bells-1);
-
+int splices::falseness_flags( arguments const& args )
+{
   int flags = 0; 
-  if ( args.in_course ) {
+  if ( args.in_course ) 
     flags |= falseness_table::in_course_only;
-    max_size /= 2;
-  }
-  else if ( args.out_of_course ) {
+  else if ( args.out_of_course ) 
     flags |= falseness_table::out_of_course_only;
-    max_size /= 2;
-  }
   if ( args.half_leads ) 
     flags |= falseness_table::half_lead_only;
+  return flags;
+}
+
+// Returns the description of the splice, or an empty string if it is not
+// to be shown.  Anything else to be printed is written to os.  This is
+// called concurrently from several threads.
+string splices::analyse_splice( falseness_table const& ft, ostream& os ) const
+{ 
+  size_t max_size = factorial(args.bells-1);
+  if ( args.in_course || args.out_of_course )
+    max_size /= 2;
 
-  falseness_table ft( a, b, flags );
   if ( args.print_falseness ) {
-    copy( ft.begin(), ft.end(), ostream_iterator<row>(cout, "\n") );
+    copy( ft.begin(), ft.end(), ostream_iterator<row>(os, "\n") );
     return string();
   }
 
-  group sg( ft.generate_group() );
+  // If the treble is fixed, max_size really is the largest the group
+  // can be, and unless we need its elements, there's no need to finish 
+  // generating it once it's clear that it is that large.
+  size_t order_bound = args.print_group || args.null_splices ? 0 : max_size;
+  for ( falseness_table::const_iterator i=ft.begin(), e=ft.end(); 
+        order_bound && i!=e; ++i )
+    if ( (*i)[0] != 0 ) 
+      order_bound = 0;
+
+  group sg( ft.generate_group( order_bound ) );
   if ( args.print_group ) {
-    copy( sg.begin(), sg.end(), ostream_iterator<row>(cout, "\n") );
+    copy( sg.begin(), sg.end(), ostream_iterator<row>(os, "\n") );
     return string();
   }
 
@@ -542,13 +581,25 @@ string splices::test_splice( method const& a, vector<row> const& b,
   if ( args.only_n_leads != -1 && sg.size() != args.only_n_leads * 2 )
     return string();
 
-  string desc( describe_splice(sg) );
-  if ( !args.group_splices && !args.filter_mode ) {
-    cout << name_or_pn(args, a);
-    if ( args.meth.size() != 1 ) 
-      cout << " / " << b_name;
-    cout << "\t" << desc << "\n";
-  }
+  return describe_splice(sg);
+}
+
+void splices::print_splice( method const& a, string const& b_name, 
+                            string const& desc ) const
+{
+  cout << name_or_pn(args, a);
+  if ( args.meth.size() != 1 ) 
+    cout << " / " << b_name;
+  cout << "\t" << desc << "\n";
+}
+
+string splices::test_splice( method const& a, vector<row> const& b,
+                             string const& b_name )
+{ 
+  string desc( analyse_splice( falseness_table( a, b, falseness_flags(args) ),
+                               cout ) );
+  if ( desc.size() && !args.group_splices && !args.filter_mode )
+    print_splice( a, b_name, desc );
   return desc;
 }
 
@@ -584,14 +635,113 @@ method splices::get_method( library_entry const& e )
   return m;
 }
 
-void splices::find_splices( library const& lib )
+// Tests the pairs of methods for which falseness_matrix::for_each_pair
+// is called, and stores the results, which are printed in order later.
+class splices::pair_tester : public falseness_matrix::pair_function
 {
-  // The source library may not support restarting (e.g. if its 
-  // a litelib on stdin), so load them into a methodset as we 
-  // find them.
-  methodset meths;
-  meths.store_facet< litelib::payload >();
+public:
+  pair_tester( splices const& s, size_t first, size_t last ) 
+    : s(s), first(first), results( last - first ) {}
+
+  struct result 
+  {
+    result( size_t j, string const& out, string const& desc ) 
+      : j(j), out(out), desc(desc) {}
+
+    size_t j;
+    string out, desc;
+  };
+
+  // The earlier methods are taken in order of their place notation
+  struct result_cmp 
+  {
+    explicit result_cmp( vector<method> const& meths ) : meths(meths) {}
+
+    bool operator()( result const& x, result const& y ) const {
+      return static_cast< vector<change> const& >( meths[x.j] )
+        < static_cast< vector<change> const& >( meths[y.j] );
+    }
+
+    vector<method> const& meths;
+  };
+
+  virtual bool wanted( size_t i, size_t j ) const
+  {
+    // If we're grouping splices, this gets done later.  This is so that
+    // we can output, e.g.  Bv,Su / Bk,He  for surprise minor lead splices.
+    if ( !s.args.group_splices && s.args.same_le 
+         && s.meths[i].back() != s.meths[j].back() )
+      return false;
+
+    // Only the first occurrence of a method is compared against later ones
+    return !s.duplicate[j];
+  }
+
+  virtual void operator()( size_t i, size_t j, falseness_table const& ft )
+  {
+    make_string os;
+    string const desc( s.analyse_splice( ft, os.out_stream() ) );
+    string const out( os );
+    if ( desc.size() || out.size() ) {
+      mutex::scoped_lock l(m);
+      results[i - first].push_back( result( j, out, desc ) );
+    }
+  }
+
+  // The results for method i, in the order they are to be printed
+  vector<result>& get( size_t i ) 
+  {
+    vector<result>& r = results[i - first];
+    sort( r.begin(), r.end(), result_cmp( s.meths ) );
+    return r;
+  }
 
+private:
+  splices const& s;
+  size_t first;
+  mutex m;
+  vector< vector<result> > results;
+};
+
+// Find the splices between each pending method and all earlier ones
+void splices::test_pending()
+{
+  size_t const first = meths.size() - pending.size(), last = meths.size();
+
+  pair_tester pt( *this, first, last );
+  matrix.for_each_pair( first, last, pt );
+
+  for ( size_t i = first; i < last; ++i ) {
+    vector<pair_tester::result> const& r = pt.get(i);
+    for ( vector<pair_tester::result>::const_iterator 
+            ri = r.begin(), re = r.end(); ri != re; ++ri ) {
+      cout << ri->out;
+      if ( ri->desc.empty() ) 
+        continue;
+
+      if ( args.group_splices || args.filter_mode )
+        save_splice( meths[i], meths[ri->j], ri->desc );
+      else
+        print_splice( meths[i], name_or_pn(args, meths[ri->j]), ri->desc );
+    }
+
+    pending_method const& p = pending[i - first];
+    if ( args.filter_mode && !has_lead_splices(p.meth) )
+      cout << p.filter_line;
+  }
+
+  pending.clear();
+}
+
+string splices::filter_line( library_entry const& e )
+{
+  return make_string() 
+    << e.meth().format( method::M_FULL_SYMMETRY | method::M_DASH )
+    << "\t" << e.get_facet< litelib::payload >() << "\n";
+}
+
+void splices::find_splices( library const& lib )
+{
   typedef library::const_iterator const_iterator;
   for ( const_iterator i=lib.begin(), e=lib.end(); i!=e; ++i ) 
   {
@@ -609,19 +759,28 @@ void splices::find_splices( library const& lib )
     }
 
     else {
-      for ( const_iterator j=meths.begin(), f=meths.end(); j!=f; ++j )
-        test_splice( m, get_method(*j) );
-
-      meths.push_back(*i);
-
-      filter_ok = !has_lead_splices(i->meth());
+      // The library may not support restarting (e.g. if it's a litelib 
+      // on stdin), so the methods are stored as they are read, and 
+      // compared against the earlier ones in batches.
+      matrix.push_back(m);
+      meths.push_back(m);
+      duplicate.push_back( !distinct.insert( i->meth() ).second );
+      pending.push_back( pending_method() );
+      pending.back().meth = i->meth();
+      if ( args.filter_mode )
+        pending.back().filter_line = filter_line(*i);
+
+      if ( pending.size() == matrix.tile_size() )
+        test_pending();
     }
 
     if ( args.filter_mode && filter_ok )
-      cout << i->meth().format( method::M_FULL_SYMMETRY | method::M_DASH )
-           << "\t" << i->get_facet< litelib::payload >() << "\n";
+      cout << filter_line(*i);
   }
 
+  if ( pending.size() )
+    test_pending();
+
   if ( args.group_splices ) 
     print_splice_groups();
 }
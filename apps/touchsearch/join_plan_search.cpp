@@ -26,14 +26,19 @@
 #if RINGING_OLD_INCLUDES
 #include <vector.h>
 #include <bvector.h>
+#include <list.h>
+#include <algo.h>
 #else
 #include <vector>
+#include <list>
+#include <algorithm>
 #endif
 #include <ringing/search_base.h>
 #include <ringing/falseness.h>
 #include <ringing/multtab.h>
 #include <ringing/extent.h>
 #include <ringing/touch.h>
+#include <ringing/parallel.h>
 #include "join_plan_search.h"
 
 #define DEBUG_LEVEL 0
@@ -55,7 +60,7 @@ join_plan_search::join_plan_search( unsigned int bells,
                                     vector<change> const& calls,
                                     join_plan_search::flags f )
   : plan(plan), calls(calls), lenrange( size_t(0), size_t(-1) ), 
-    f(f), bells(bells)
+    f(f), bells(bells), task_depth(0)
 {}
 
 join_plan_search::join_plan_search( unsigned int bells, 
@@ -64,15 +69,16 @@ join_plan_search::join_plan_search( unsigned int bells,
                                     pair<size_t, size_t> lenrange,
                                     join_plan_search::flags f )
   : plan(plan), calls(calls), lenrange(lenrange), 
-    f(f), bells(bells)
+    f(f), bells(bells), task_depth(0)
 {}
 
 class join_plan_search::context : public search_base::context_base
 {
 public:
   context( const join_plan_search* s ) 
-    : lenrange( s->lenrange ),
-      table( make_table(s) )
+    : lenrange( s->lenrange ), task_depth( s->task_depth ),
+      range_first( s->get_range_first() ), range_last( s->get_range_last() ),
+      table( make_table(s) ), meter( *s )
   {
     DEBUG( "Constructing context: table size " << table.size() );
 
@@ -120,12 +126,10 @@ private:
   static multtab make_table( const join_plan_search *s )
   {
     if ( is_in_course(s) ) {
-      return multtab( incourse_extent_iterator( s->bells - 1, 1),
-                      incourse_extent_iterator() );
+      return multtab( incourse_extent( s->bells - 1, 1 ) );
     }
     else {
-      return multtab( extent_iterator( s->bells - 1, 1 ),
-                      extent_iterator() );
+      return multtab( extent( s->bells - 1, 1 ) );
     }
   }
 
@@ -166,15 +170,225 @@ private:
     }
   }
 
+  // Logically this is a vector<bool>, but the C++ standard mandates 
+  // that that should be a packed structure.  Changing to vector<char>
+  // makes a small but significant speed improvement.
+  typedef vector<char> lead_vector_t;
+
+  // When searching in parallel, the tree is split into tasks, as in 
+  // table_search.  Each is either the range of the tree below a sequence
+  // of calls or, if search is false, touches that were found while 
+  // splitting the tree, given by their touch nodes.
+  struct task
+  {
+    task() : search( false ), done( false ) {}
+
+    position start, end;                // The range to search
+    bool search;                        // Is there a range to search?
+    bool done;                          // Has the task finished?
+    vector< vector< size_t > > touches; // Touches waiting to be output
+  };
+
+  // The state of a depth-first search through all or part of the tree.
+  // Each thread has its own.
+  struct worker
+  {
+    explicit worker( size_t n ) 
+      : leads( n, false ), halt( false ), 
+        buffer( 0 ), tasks( 0 ), split_depth( size_t(-1) ), nodes( 0ul )
+    {}
+
+    lead_vector_t leads;                // The leads had so far
+    vector< size_t > comp;              // The touch node of each lead
+    position calls;                     // ... and the call at each
+    bool halt;                          // Are we terminating the search?
+    position start, end;                // The range to search
+    vector< vector< size_t > > *buffer; // If set, hold touches here
+    vector< task > *tasks;              // If set, split the tree into these
+    size_t split_depth;                 // ... at this depth
+    RINGING_ULLONG nodes;               // Node count
+    statistics stats;                   // Counts since last merged into meter
+    statistics uncounted;               // Counts that are discarded
+  };
+
+  // Runs each task by calling context::run_task
+  class task_runner;
+  friend class task_runner;
+  class task_runner : public parallel_task
+  {
+  public:
+    task_runner( context &c, vector< task > &tasks, bool in_order )
+      : c( c ), tasks( tasks ), in_order( in_order ) {}
+
+    virtual void run( size_t i ) { c.run_task( tasks, i, in_order ); }
+
+  private:
+    context &c;
+    vector< task > &tasks;
+    bool in_order;
+  };
+
+  virtual bool supports_ranges() const { return true; }
+
   virtual void run( outputer &output ) 
   {
-    force_halt = false;
-    nodes = 0ul;
-    lead_vector_t( table.size(), false ).swap( leads );
-    run_recursive( output, row_t(), 0 );
+    out = &output;  halted = false;  parallel = false;
+    meter.start();
+    worker w( table.size() );
+    w.start = range_first;  w.end = range_last;
+    run_recursive( w, row_t(), 0, true, !w.end.empty() );
+    merge( w );
+    meter.report( *out );
+  }
+
+  // Split the tree into tasks at the task depth, and hand them out to
+  // the threads as they become free.  
+  virtual void run( outputer &output, unsigned threads, bool in_order )
+  {
+    if ( !threads ) threads = default_thread_count();
+
+    out = &output;  halted = false;  parallel = true;
+    meter.start();
+
+    vector< task > tasks;
+    {
+      worker w( table.size() );
+      w.start = range_first;  w.end = range_last;
+      w.tasks = &tasks;
+      w.split_depth = task_depth ? task_depth : default_task_depth(threads);
+      run_recursive( w, row_t(), 0, true, !w.end.empty() );
+      merge( w );
+    }
+    DEBUG( "Split the search into " << tasks.size() << " tasks" );
+
+    next_task = 0;
+    task_runner r( *this, tasks, in_order );
+    run_parallel( r, tasks.size(), threads );
+
+    for ( list< worker >::iterator i( workers.begin() ); 
+          i != workers.end(); ++i )
+      merge( *i );
+    meter.report( *out );
+    workers.clear();  idle.clear();
+  }
+
+  // Add the worker's counts since it was last merged to the totals.  
+  // In a parallel search, the output lock must be held.
+  void merge( worker &w )
+  {
+    meter.stats += w.stats;
+
+    w.stats.nodes = w.stats.false_nodes = w.stats.non_canonical 
+      = w.stats.too_long = w.stats.bounded = 0;
+    fill( w.stats.depths.begin(), w.stats.depths.end(), 0 );
+  }
+
+  // The smallest depth giving a few dozen tasks per thread.  Leads 
+  // outside the plan end a branch early, so this is only a guide.
+  size_t default_task_depth( unsigned threads ) const
+  {
+    size_t depth = 1;
+    for ( size_t n = call_les.size(); 
+          call_les.size() > 1 && n < 64 * threads; n *= call_les.size() )
+      ++depth;
+    return depth;
+  }
+
+  void run_task( vector< task > &tasks, size_t i, bool in_order )
+  {
+    task &t = tasks[i];
+    if ( t.search && !is_halted() ) {
+      worker *w = acquire_worker();
+      w->start = t.start;  w->end = t.end;
+      w->buffer = in_order ? &t.touches : 0;
+      w->halt = false;
+      run_recursive( *w, row_t(), 0, true, true );
+      release_worker( w );
+    }
+
+    mutex::scoped_lock l( output_lock );
+    if ( meter.due() ) 
+      meter.report( *out );
+    if ( !in_order ) 
+      flush( t.touches );
+    else {
+      t.done = true;
+      size_t const n = next_task;
+      while ( next_task < tasks.size() && tasks[next_task].done )
+        flush( tasks[next_task++].touches );
+      if ( next_task != n && next_task < tasks.size() && !halted )
+        out->checkpoint( tasks[next_task].start );
+    }
+  }
+
+  // Output a list of touches.  The output lock must be held.
+  void flush( vector< vector< size_t > > &touches )
+  {
+    for ( vector< vector< size_t > >::const_iterator i( touches.begin() ); 
+          !halted && i != touches.end(); ++i )
+      halted = output_touch( *i );
+    vector< vector< size_t > >().swap( touches );
+  }
+
+  bool is_halted()
+  {
+    mutex::scoped_lock l( output_lock );
+    return halted;
   }
 
-  void output_touch( outputer& output )
+  // Called periodically by each thread.  Returns true if the search 
+  // has been halted.
+  bool poll( worker &w )
+  {
+    mutex::scoped_lock l( output_lock );
+    merge( w );
+    if ( meter.due() ) 
+      meter.report( *out );
+    return halted;
+  }
+
+  worker *acquire_worker()
+  {
+    mutex::scoped_lock l( worker_lock );
+    if ( idle.empty() ) {
+      workers.push_back( worker( table.size() ) );
+      return &workers.back();
+    }
+    worker *w = idle.back();  idle.pop_back();
+    return w;
+  }
+
+  void release_worker( worker *w )
+  {
+    mutex::scoped_lock l( worker_lock );
+    idle.push_back( w );
+  }
+
+  // Deal with a touch that has been found: either output it, or keep 
+  // it to be output later.
+  void found( worker &w )
+  {
+    DEBUG( "Have touch" );
+    if ( w.tasks ) {
+      if ( w.tasks->empty() || w.tasks->back().search ) {
+        w.tasks->push_back( task() );
+        w.tasks->back().start = w.calls;
+      }
+      w.tasks->back().touches.push_back( w.comp );
+    }
+    else if ( w.buffer )
+      w.buffer->push_back( w.comp );
+    else if ( !parallel )
+      w.halt = output_touch( w.comp );
+    else {
+      mutex::scoped_lock l( output_lock );
+      if ( !halted ) halted = output_touch( w.comp );
+      w.halt = halted;
+    }
+  }
+
+  // Returns true if the search should halt
+  bool output_touch( const vector< size_t > &comp )
   {
     list< touch_child_list::entry > &ch = tl->children();
     ch.clear();
@@ -182,19 +396,70 @@ private:
     for ( size_t i=0, n=comp.size(); i < n; ++i )
       tl->push_back( 1, t.get_node(comp[i]) );
 
-    DEBUG( "Have touch" );
-    force_halt = output( t );
+    ++meter.stats.touches;
+    return (*out)( t );
   }
 
-  // The main loop of the algorithm   
-  void run_recursive( outputer &output, const row_t &lh, size_t depth )
+  // Add a task for the subtree below the current node, or the part of
+  // it within the range.
+  void split( worker &w, bool on_end )
+  {
+    w.tasks->push_back( task() );
+    task &t = w.tasks->back();
+    t.search = true;
+
+    t.start = max( w.calls, w.start );
+    t.end = w.calls;  ++t.end.back();
+    if ( on_end ) t.end = min( t.end, w.end );
+  }
+
+  // The main loop of the algorithm.  The node is on the path to the 
+  // start or end of the range being searched if on_start or on_end is
+  // set.
+  void run_recursive( worker &w, const row_t &lh, size_t depth,
+                      bool on_start, bool on_end )
   {
 #if DEBUG_LEVEL > 1
-    IF_DEBUG( copy( comp.begin(), comp.end(), ostream_iterator<int>(cout) ));
+    IF_DEBUG( copy( w.comp.begin(), w.comp.end(), 
+                    ostream_iterator<int>(cout) ));
     DEBUG( " at depth " << depth );
 #endif 
       
-    IF_DEBUG( (++nodes % 1000000 == 0) && (cout << "Node: " << nodes << "\n") );
+    IF_DEBUG( (w.nodes % 1000000 == 0) 
+              && (cout << "Node: " << w.nodes << "\n") );
+
+    // Have we reached the end of the range?
+    size_t const level = w.calls.size();
+    if ( on_end && level == w.end.size() ) {
+      w.halt = true;
+      return;
+    }
+
+    // Nodes leading to the start of the range come before it
+    bool const before_start = on_start && level < w.start.size();
+
+    if ( ++w.nodes % poll_interval == 0 ) {
+      // In a parallel search, check whether another thread has halted 
+      // the search; otherwise let the outputer record where we are.
+      if ( parallel ) 
+        w.halt = poll( w ) || w.halt;
+      else {
+        if ( w.nodes % checkpoint_interval == 0 && !before_start )
+          out->checkpoint( w.calls );
+        if ( meter.due() ) {
+          merge( w );
+          meter.report( *out );
+        }
+      }
+    }
+
+    // Nodes on the way to the start of the range are counted by the 
+    // search of the part of the tree before it, and nodes where the tree
+    // is split by the task that searches below them.
+    statistics &st = before_start ? w.uncounted : w.stats;
+    ++st.nodes;
+    if ( level >= st.depths.size() ) st.depths.resize( level + 1 );
+    ++st.depths[level];
 
     int meth_n = plan[ lh.index() ];
     if ( meth_n == -1 ) return;  // We're outside of the plan.
@@ -202,35 +467,64 @@ private:
     row_t const le( lh * les[meth_n] );
 
     // Is it going to repeat?
-    if ( leads[lh.index()] || leads[le.index()] ) 
+    if ( w.leads[lh.index()] || w.leads[le.index()] ) 
       {
+        ++st.false_nodes;
+
         // Has it come round, and is it in it's canonical form?
-        if ( depth >= lenrange.first && lh.isrounds() )
-          output_touch( output );
+        if ( depth >= lenrange.first && lh.isrounds() && !before_start )
+          found( w );
       }
     else if ( depth < lenrange.second )
       {
+        // Leave the subtree to be searched as a separate task
+        if ( level == w.split_depth ) {
+          --st.nodes;  --st.depths[level];
+          split( w, on_end );
+          return;
+        }
+
         const int num_meths = les.size();
 
-        leads[lh.index()] = true;
-        leads[le.index()] = true;
-        comp.push_back( num_meths + meth_n + 1 );
+        // Skip the calls outside the range
+        size_t first = 0, last = call_les.size();
+        if ( before_start ) 
+          first = w.start[level];
+        if ( on_end && w.end[level] < last ) 
+          last = w.end[level] + 1;
 
-        for ( int i = 0, n = call_les.size(); !force_halt && i < n; ++i )
+        w.leads[lh.index()] = true;
+        w.leads[le.index()] = true;
+        w.comp.push_back( num_meths + meth_n + 1 + first * (num_meths + 1) );
+        w.calls.push_back( first );
+
+        for ( ; !w.halt && w.calls.back() < last; ++w.calls.back() )
           {
-            run_recursive( output, le * call_les[i], depth + lens[meth_n] );
-            comp.back() += num_meths + 1;
+            size_t const i = w.calls.back();
+            run_recursive( w, le * call_les[i], depth + lens[meth_n],
+                           before_start && i == w.start[level],
+                           on_end && i == w.end[level] );
+            w.comp.back() += num_meths + 1;
           }
 
-        comp.pop_back();
-        leads[le.index()] = false;
-        leads[lh.index()] = false;
+        w.calls.pop_back();
+        w.comp.pop_back();
+        w.leads[le.index()] = false;
+        w.leads[lh.index()] = false;
       }
+    else
+      ++st.too_long;
   }
 
+  // How often a thread checks whether another has halted the search,
+  // and how often the outputer is given a checkpoint
+  static size_t const poll_interval = 4096;
+  static size_t const checkpoint_interval = 1 << 20;
+
   // Data members
   pair< size_t, size_t > lenrange;      // The min & max lengths (in leads)
-  bool force_halt;                      // Are we terminating the search?
+  size_t task_depth;                    // The depth at which to split
+  position range_first, range_last;     // The range to search
   multtab table;                        // A precomputed multiplication table
 
   touch t;                              // The current touch
@@ -240,17 +534,22 @@ private:
   vector< int > plan;                   // Map multtab::row_t => index into les
   vector< post_col_t > call_les;
 
-  RINGING_ULLONG nodes;                 // Node count
-
-  // Logically this is a vector<bool>, but the C++ standard mandates 
-  // that that should be a packed structure.  Changing to vector<char>
-  // makes a small but significant speed improvement.
-  typedef vector<char> lead_vector_t;
-  lead_vector_t leads;                  // The leads had so far
-
-  vector< size_t > comp;                // The calls we've had so far
+  // The state of the current run
+  outputer *out;
+  bool parallel;                        // Are several threads searching?
+  mutex output_lock;                    // Protects out, t and the following
+  bool halted;                          // Are we terminating the search?
+  size_t next_task;                     // The next task to output, in order
+  progress_meter meter;                 // Statistics for the run
+
+  mutex worker_lock;                    // Protects the following
+  list< worker > workers;               // The state for each thread
+  vector< worker * > idle;              // Workers not in use
 };
 
+size_t const join_plan_search::context::poll_interval;
+size_t const join_plan_search::context::checkpoint_interval;
+
 search_base::context_base *join_plan_search::new_context() const
 {
   return new context(this);
@@ -63,6 +63,10 @@ public:
                     vector<change> const& calls, pair<size_t, size_t> lenrange,
                     flags = no_flags );
 
+  // As for table_search, the depth at which a search on several threads
+  // is split into tasks, or 0 to choose one
+  void set_task_depth( size_t depth ) { task_depth = depth; }
+
 private:
   // The implementation
   class context;
@@ -75,6 +79,7 @@ private:
   pair< size_t, size_t > lenrange;
   flags                  f;
   unsigned               bells;
+  size_t                 task_depth;
 };
 
 RINGING_END_NAMESPACE
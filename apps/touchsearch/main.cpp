@@ -24,9 +24,13 @@
 #include <ringing/method.h>
 #include <ringing/streamutils.h>
 #include <ringing/table_search.h>
+#include <ringing/spliced_search.h>
 #include <ringing/touch.h>
 #include <ringing/pointers.h>
 #include <ringing/litelib.h>
+#include <ringing/lexical_cast.h>
+#include <ringing/multtab.h>
+#include <ringing/parallel.h>
 
 #include "prog_args.h"
 #include "iteratorutils.h"
@@ -40,12 +44,16 @@
 #endif
 #if RINGING_OLD_IOSTREAMS
 #include <iostream.h>
+#include <iomanip.h>
 #include <fstream.h>
 #else
 #include <iostream>
+#include <iomanip>
 #include <fstream>
 #endif
 #include <cassert>
+#include <cstdio>
+#include <ctime>
 
 
 RINGING_USING_NAMESPACE
@@ -68,18 +76,61 @@ public:
     write_out_repeat = 0x08   // Write abcd x3 or abcdabcdabcd
   };
  
-  print_touch( arguments const& args, 
-               string const& filter_line, format_options flags ) 
-    : args(args), filter_line(filter_line), flags(flags)
+  // Touches are written to os, and counted in count
+  print_touch( arguments const& args, size_t lead_len,
+               string const& filter_line, format_options flags,
+               ostream& os = cout, RINGING_ULLONG& count = touch_count ) 
+    : args(args), lead_len(lead_len), filter_line(filter_line), flags(flags),
+      os(os), count(count)
   {}
 
+  // Prints the touch from the call numbers, without building it
+  void operator()( const search_base::call_sequence &c ) const
+  {
+    ++count;
+    if (args.quiet) return;
+
+    if (args.filter_mode)
+      os << filter_line << "\t";
+
+    // Spliced touches have the label of each lead's method before its call
+    bool const spliced = !args.splice_meths.empty();
+    size_t len = 0;
+    unsigned const reps = (flags & write_out_repeat) ? c.parts() : 1;
+    for ( unsigned n = 0; n < reps; ++n )
+      for ( size_t i = 0; i < c.size(); ++i ) 
+      {
+        if ( (flags & comma_separate) && (n || i) ) os << ',';
+        if ( spliced ) {
+          os << args.splice_labels[ c.method_index(i) ];
+          len += args.splice_meths[ c.method_index(i) ].size();
+        }
+        else len += lead_len;
+
+        if ( c[i] ) os << args.call_strs[c[i] - 1];
+        else if ( !spliced || (flags & comma_separate) ) 
+          os << args.plain_name;
+      }
+
+    if ( reps == 1 && c.parts() > 1 ) 
+      os << " x" << c.parts();
+
+    if ( flags & print_length )
+      os << "  (" << (len*c.parts()) << " changes)";
+
+    if ( args.music_strs.size() )
+      os << "  score " << c.score();
+
+    os << endl;
+  }
+
   void operator()( const touch &t ) const
   {
-    ++touch_count;
+    ++count;
     if (args.quiet) return;
 
     if (args.filter_mode)
-      cout << filter_line << "\t";
+      os << filter_line << "\t";
 
     touch_child_list const* tl 
       = dynamic_cast<touch_child_list const*>( t.get_head() );
@@ -100,39 +151,42 @@ public:
         size_t cn = find( args.calls.begin(), args.calls.end(), c ) 
             - args.calls.begin();
 
-        if ( (flags & comma_separate) && len != 0 ) cout << ',';
-        if ( cn < args.calls.size() ) cout << args.call_strs[cn];
-        else cout << args.plain_name;
+        if ( (flags & comma_separate) && len != 0 ) os << ',';
+        if ( cn < args.calls.size() ) os << args.call_strs[cn];
+        else os << args.plain_name;
       }
     }
     while ( (flags & write_out_repeat) && r.order() > 1 );
 
     if ( r.order() > 1 ) 
-      cout << " x" << r.order();
+      os << " x" << r.order();
 
     if ( flags & print_length )
-      cout << "  (" << (len*r.order()) << " changes)";
+      os << "  (" << (len*r.order()) << " changes)";
 
-    cout << endl;
+    os << endl;
   } 
 
 private:
   arguments const& args;
+  size_t lead_len;
   string filter_line;
   int flags;
+  ostream& os;
+  RINGING_ULLONG& count;
 };
 
 class have_finished
 {
 public:
-  typedef touch argument_type;
   typedef bool result_type;
 
   have_finished( arguments const& args )
     : args(args), i(new size_t(0u))
   {}
 
-  bool operator()( const touch& )
+  // Called after each touch is output
+  bool operator()()
   {
     // Abort when we reach the --limit
     return args.search_limit != -1 && ++*i >= (size_t)args.search_limit 
@@ -145,6 +199,110 @@ private:
   shared_pointer<size_t> i;
 };
 
+// Passes touches to the printer until the search should finish, saves
+// the position of the search to the --checkpoint file from time to time,
+// and displays the --status
+class touch_output : public search_base::outputer
+{
+public:
+  touch_output( arguments const& args, print_touch const& printer )
+    : args(args), printer(printer), until(args), last_save(time(NULL)),
+      halted(false), status_len(0)
+  {}
+
+  virtual bool operator()( const touch& t )
+  {
+    clear_status();
+    printer(t);
+    return halted = until();
+  }
+
+  virtual bool operator()( const search_base::call_sequence& c )
+  {
+    clear_status();
+    printer(c);
+    return halted = until();
+  }
+
+  virtual void progress( const search_base::statistics& s )
+  {
+    if ( !args.status ) return;
+
+    make_string os;
+    os << "Searched " << s.nodes << " nodes";
+    if ( s.elapsed > 0 ) 
+      os << " (" << static_cast<RINGING_ULLONG>( s.nodes / s.elapsed ) 
+         << "/s)";
+    os << ", found " << s.touches << " touches";
+    if ( s.estimated_nodes > 0 ) 
+      os << ", " << int( 100 * s.nodes / s.estimated_nodes ) 
+         << "% of an estimated " << setprecision(2) << s.estimated_nodes;
+
+    string const str( os );
+    clear_status();
+    cerr << str << flush;
+    status_len = str.size();
+  }
+
+  // Remove the status line, if any
+  void clear_status()
+  {
+    if ( status_len ) {
+      cerr << '\r' << string( status_len, ' ' ) << '\r' << flush;
+      status_len = 0;
+    }
+  }
+
+  virtual void checkpoint( const search_base::position& pos )
+  {
+    time_t const now = time(NULL);
+    if ( args.checkpoint_file.empty() || now - last_save < save_interval )
+      return;
+    last_save = now;
+
+    // Everything before pos must have been written before it is saved
+    cout << flush;
+
+    // Write to a temporary file and rename it, so that a search that is
+    // interrupted part way through saving leaves the old checkpoint.
+    string const tmp( args.checkpoint_file + ".tmp" );
+    {
+      ofstream out( tmp.c_str() );
+      out << search_base::format_position(pos) << "\n";
+      if ( !out ) 
+        throw runtime_error( "Unable to write checkpoint to " + tmp );
+    }
+    if ( rename( tmp.c_str(), args.checkpoint_file.c_str() ) )
+      throw runtime_error( "Unable to save checkpoint to " 
+                           + args.checkpoint_file );
+  }
+
+  bool was_halted() const { return halted; }
+
+private:
+  static time_t const save_interval = 10;  // seconds
+
+  arguments const& args;
+  print_touch const& printer;
+  have_finished until;
+  time_t last_save;
+  bool halted;
+  size_t status_len;
+};
+
+// Returns the position saved in the --checkpoint file, or the --from 
+// position if there is no checkpoint
+search_base::position start_position( arguments const& args )
+{
+  if ( args.checkpoint_file.size() ) {
+    ifstream in( args.checkpoint_file.c_str() );
+    string line;
+    if ( in && getline( in, line ) ) 
+      return search_base::parse_position( line );
+  }
+  return args.from;
+}
+
 void read_plan( int bells, istream& in, map<row, method>& plan )
 {
   string line;  
@@ -162,17 +320,20 @@ void read_plan( int bells, istream& in, map<row, method>& plan )
   }
 }
 
-void search( arguments const& args, method const& meth, 
-             string const& filter_line )
+print_touch::format_options format( arguments const& args )
 {
-  print_touch::format_options fmt = static_cast<print_touch::format_options>( 
+  return static_cast<print_touch::format_options>( 
     args.comma_separate ? 
       ( print_touch::comma_separate | print_touch::write_out_repeat ) 
     : print_touch::print_length );
+}
 
+// Constructs the search for meth.  If table is not null, it is used as
+// the multiplication table of a table_search.
+search_base* make_search( arguments const& args, method const& meth,
+                          multtab* table = NULL )
+{
   scoped_pointer<search_base> searcher;
-  
-  print_touch printer( args, filter_line, fmt );
 
   if ( args.use_plan ) {
     // XXX: Should this require a command-line option?
@@ -183,28 +344,123 @@ void search( arguments const& args, method const& meth,
     searcher.reset
       ( new join_plan_search( args.bells, plan, args.calls, args.length, f ) );
   } 
+  else if ( args.splice_meths.size() ) {
+    spliced_search::flags f = static_cast<spliced_search::flags>( 
+      spliced_search::length_in_changes | 
+      (args.ignore_rotations ? spliced_search::ignore_rotations : 0) |
+      (args.round_blocks ? 0 : spliced_search::non_round_blocks ) |
+      (args.mutually_true_parts ? spliced_search::mutually_true_parts : 0) );
+
+    spliced_search *s = new spliced_search( args.splice_meths, args.calls, 
+                                            args.pends, args.length, f );
+    searcher.reset( s );
+
+    s->set_changes_of_method( args.changes_of_method.first,
+                              args.changes_of_method.second );
+  }
   else {
     table_search::flags f = static_cast<table_search::flags>( 
       table_search::length_in_changes | 
       (args.ignore_rotations ? table_search::ignore_rotations : 0) |
+      (args.ignore_reversals ? table_search::ignore_reversals : 0) |
+      (args.ignore_conjugates ? table_search::ignore_conjugates : 0) |
       (args.round_blocks ? 0 : table_search::non_round_blocks ) |
       (args.mutually_true_parts ? table_search::mutually_true_parts : 0) );
 
-    searcher.reset
-      ( new table_search( meth, args.calls, args.pends, args.length, f ) );
+    table_search *s 
+      = new table_search( meth, args.calls, args.pends, args.length, f );
+    searcher.reset( s );
+
+    if ( args.music_strs.size() ) 
+      s->set_music( args.mus, args.best, args.min_score );
+    if ( table )
+      s->set_table( *table );
   }
 
-  touch_search_until( *searcher, iter_from_fun(printer), have_finished(args) );
+  if ( args.from.size() || args.to.size() || args.checkpoint_file.size() )
+    searcher->set_range( start_position(args), args.to );
+
+  return searcher.release();
 }
 
-void filter( arguments const& args )
+void search( arguments const& args )
 {
-  litelib in( args.bells, std::cin );
-  for ( library::const_iterator i=in.begin(), e=in.end(); i!=e; ++i )
-    {
-      method filter_method;
+  scoped_pointer<search_base> searcher( make_search( args, args.meth ) );
+  
+  print_touch printer( args, args.meth.size(), string(), format(args) );
+
+  if ( args.status )
+    searcher->set_progress_interval( args.status_interval );
+
+  touch_output out( args, printer );
+  searcher->run( out, args.threads, args.in_order );
+
+  // Leave the final statistics on display
+  if ( args.status ) 
+    cerr << endl;
+
+  // The search has finished, so there is nothing left to resume
+  if ( args.checkpoint_file.size() && !out.was_halted() )
+    remove( args.checkpoint_file.c_str() );
+}
+
+// Runs a --filter, searching several methods at once when using several
+// threads.  Each thread repeatedly takes the next method from the input,
+// searches it with a multiplication table kept by the thread from one 
+// method to the next, and writes the output of any methods whose turn 
+// it now is, so that the output is in the same order as the input.
+class filter_task : public parallel_task
+{
+public:
+  filter_task( arguments const& args, unsigned threads )
+    : args(args), in( args.bells, cin ), i( in.begin() ), e( in.end() ),
+      read_count(0), write_count(0), start( wall_clock() ), 
+      last_status( start ), status_len(0), tables( threads )
+  {}
+
+  virtual void run( size_t thread )
+  {
+    method meth;  string filter_line;  size_t n;
+    while ( read( meth, filter_line, n ) ) {
+      make_string os;  RINGING_ULLONG count = 0;
+      {
+        scoped_pointer<search_base> 
+          searcher( make_search( args, meth, &tables[thread] ) );
+        print_touch printer( args, meth.size(), filter_line, format(args),
+                             os.out_stream(), count );
+        touch_output out( args, printer );
+        searcher->run( out, 1 );
+      }
+      write( n, os, count );
+    }
+  }
+
+  // Display the number of methods searched and the rate
+  void status()
+  {
+    make_string os;
+    double const elapsed = wall_clock() - start;
+    os << "Searched " << write_count << " methods";
+    if ( elapsed > 0 ) 
+      os << " (" << static_cast<RINGING_ULLONG>( write_count / elapsed ) 
+         << "/s)";
+    os << ", found " << touch_count;
+
+    string const str( os );
+    clear_status();
+    cerr << str << flush;
+    status_len = str.size();
+  }
+
+private:
+  // Get the next method and its number in the input, or return false
+  // at the end of the input
+  bool read( method& meth, string& filter_line, size_t& n )
+  {
+    mutex::scoped_lock l( input_lock );
+    for ( ; i != e; ++i ) {
       try {
-        filter_method = i->meth();
+        meth = i->meth();
       } 
       catch ( std::exception const& ex ) {
         std::cerr << "Error reading method from input stream: "
@@ -216,12 +472,73 @@ void filter( arguments const& args )
         continue;
       }
 
-      string filter_line = i->pn();
+      filter_line = i->pn();
       filter_line += "\t";
       filter_line += i->get_facet<litelib::payload>();
 
-      search( args, filter_method, filter_line );
+      n = read_count++;  ++i;
+      return true;
+    }
+    return false;
+  }
+
+  // Write the output of the nth method, once that of the methods before
+  // it has been written
+  void write( size_t n, string const& output, RINGING_ULLONG count )
+  {
+    mutex::scoped_lock l( output_lock );
+    pending[n] = make_pair( output, count );
+
+    while ( pending.size() && pending.begin()->first == write_count ) {
+      clear_status();
+      cout << pending.begin()->second.first << flush;
+      touch_count += pending.begin()->second.second;
+      pending.erase( pending.begin() );
+      ++write_count;
+    }
+
+    if ( args.status && wall_clock() - last_status >= args.status_interval ) {
+      last_status = wall_clock();
+      status();
+    }
+  }
+
+  void clear_status()
+  {
+    if ( status_len ) {
+      cerr << '\r' << string( status_len, ' ' ) << '\r' << flush;
+      status_len = 0;
     }
+  }
+
+  arguments const& args;
+
+  mutex input_lock;               // Protects the following
+  litelib in;
+  library::const_iterator i, e;
+  size_t read_count;              // The number of methods read
+
+  mutex output_lock;              // Protects the following
+  map< size_t, pair< string, RINGING_ULLONG > > pending;
+  size_t write_count;             // The number of methods written
+  double start, last_status;
+  size_t status_len;
+
+  vector<multtab> tables;         // The table of each thread
+};
+
+void filter( arguments const& args )
+{
+  unsigned const threads = args.threads ? unsigned( args.threads )
+                                        : default_thread_count();
+  filter_task t( args, threads );
+  run_parallel( t, threads, threads );
+
+  // Leave the final rate on display
+  if ( args.status ) {
+    t.status();
+    cerr << endl;
+  }
 }
 
 int main( int argc, char *argv[] )
@@ -235,7 +552,7 @@ int main( int argc, char *argv[] )
       if ( args.filter_mode )
         filter( args );
       else
-        search( args, args.meth, string() );
+        search( args );
 
       if (!args.quiet && (args.count || args.raw_count))
         cout << "\n";
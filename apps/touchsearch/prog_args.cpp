@@ -32,6 +32,7 @@
 #include <ringing/method.h>
 #include <ringing/group.h>
 #include <ringing/streamutils.h>
+#include <ringing/search_base.h>
 
 #include <string>
 #if RINGING_OLD_INCLUDES 
@@ -44,7 +45,8 @@ RINGING_USING_NAMESPACE
 
 
 arguments::arguments( int argc, char** argv )
-  : length( 0u, static_cast<size_t>(-1) )
+  : length( 0u, static_cast<size_t>(-1) ),
+    changes_of_method( 0u, static_cast<size_t>(-1) )
 {
   arg_parser ap( argv[0], "touchsearch -- search for touches.",
                  "OPTIONS" );
@@ -80,6 +82,17 @@ void arguments::bind( arg_parser& p )
          ( 'r', "ignore-rotations",
            "Filter out touches only differing by a rotation",
            ignore_rotations ) );
+
+  p.add( new boolean_opt
+         ( '\0', "ignore-reversals",
+           "Filter out touches that are the reverse of another",
+           ignore_reversals ) );
+
+  p.add( new boolean_opt
+         ( '\0', "ignore-conjugates",
+           "Filter out touches that are the conjugate of another by a row "
+           "commuting with the method and part ends",
+           ignore_conjugates ) );
  
   p.add( new range_opt
          ( 'l', "length",
@@ -102,6 +115,38 @@ void arguments::bind( arg_parser& p )
            "Allow true touches that do not come round ",
            round_blocks, false ) );
 
+  p.add( new strings_opt
+         ( 'S', "splice",
+           "Search for spliced touches, with each lead of any of the "
+           "methods given by this option.  METHOD is place notation, "
+           "optionally preceded by a label and an equals sign", "METHOD",
+           splice_strs ) );
+
+  p.add( new range_opt
+         ( '\0', "changes-of-method",
+           "With --splice, the number or range of numbers of changes of "
+           "method required", "MIN-MAX",
+           changes_of_method ) );
+
+  p.add( new strings_opt
+         ( 'M', "music",
+           "Score touches by their music, and output only the best of "
+           "them, most musical first.  PATTERN is a row with wildcards or "
+           "a name such as <4-runs>, optionally preceded by a score and a "
+           "colon", "PATTERN",
+           music_strs ) );
+
+  p.add( new integer_opt
+         ( '\0', "best",
+           "With --music, output the NUM most musical touches (default 10), "
+           "or every touch if NUM is 0", "NUM",
+           best ) );
+
+  p.add( new integer_opt
+         ( '\0', "min-score",
+           "With --music, only output touches scoring at least NUM", "NUM",
+           min_score ) );
+
   p.add( new boolean_opt
          ( 'a', "use-plan",
            "Read a touch plan from standard input",
@@ -112,6 +157,16 @@ void arguments::bind( arg_parser& p )
            "Don't output the touches",
            quiet ) );
 
+  p.add( new boolean_opt
+         ( 'u', "status",
+           "Display the progress of the search",
+           status ) );
+
+  p.add( new integer_opt
+         ( '\0', "status-interval",
+           "Update the progress display every NUM seconds", "NUM",
+           status_interval ) );
+
   p.add( new boolean_opt
          ( 'g', "comma-separate",
            "Comma separate the output (suitable for passing to gsiril)",
@@ -140,8 +195,39 @@ void arguments::bind( arg_parser& p )
 
   p.add( new boolean_opt
          ( '\0', "filter",
-           "Run as a filter on a method library",
+           "Run as a filter on a method library, searching a method "
+           "on each thread",
            filter_mode ) );
+
+  p.add( new integer_opt
+         ( 'j', "threads",
+           "Search using NUM threads, or one per processor if NUM is 0",
+           "NUM",
+           threads ) );
+
+  p.add( new boolean_opt
+         ( '\0', "in-order",
+           "When using several threads, output touches in the same order "
+           "as a single-threaded search",
+           in_order ) );
+
+  p.add( new string_opt
+         ( '\0', "from",
+           "Start the search at POS, a sequence of call numbers separated "
+           "by dots (with 0 being a plain lead)", "POS",
+           from_str ) );
+
+  p.add( new string_opt
+         ( '\0', "to",
+           "Stop the search before reaching POS", "POS",
+           to_str ) );
+
+  p.add( new string_opt
+         ( '\0', "checkpoint",
+           "Periodically save the position of the search in FILE, and if "
+           "FILE exists, resume the search from the position in it.  FILE "
+           "is removed when the search finishes", "FILE",
+           checkpoint_file ) );
 }
 
 bool arguments::validate( arg_parser& ap )
@@ -165,6 +251,9 @@ bool arguments::validate( arg_parser& ap )
     return false;
   }
 
+  if ( !generate_splice( ap ) )
+    return false;
+
   if ( !filter_mode && !use_plan && meth.empty() ) {
     ap.error( "Must specify a method" );
     return false;
@@ -189,6 +278,27 @@ bool arguments::validate( arg_parser& ap )
     }
   }
 
+  if ( use_plan && filter_mode ) {
+    ap.error( "Cannot use a plan when running as a filter" );
+    return false;
+  }
+
+  if ( threads < 0 ) {
+    ap.error( "The number of threads must not be negative" );
+    return false;
+  }
+
+  if ( status_interval <= 0 ) {
+    ap.error( "The status interval must be positive" );
+    return false;
+  }
+
+  if ( !generate_range( ap ) )
+    return false;
+
+  if ( !generate_music( ap ) )
+    return false;
+
   if ( plain_name.empty() ) 
     plain_name = comma_separate ? 'p' : '.';
  
@@ -226,6 +336,117 @@ bool arguments::generate_calls( arg_parser& ap )
   return true;
 }
 
+bool arguments::generate_splice( arg_parser& ap )
+{
+  if ( splice_strs.empty() ) 
+    return true;
+
+  if ( meth.size() ) {
+    ap.error( "Must not specify a method as well as --splice" );
+    return false;
+  }
+  if ( use_plan || filter_mode ) {
+    ap.error( "Cannot splice methods when using a plan or as a filter" );
+    return false;
+  }
+  if ( ignore_reversals || ignore_conjugates || music_strs.size() ) {
+    ap.error( "Cannot splice methods when ignoring reversals or "
+              "conjugates, or scoring music" );
+    return false;
+  }
+  if ( from_str.size() || to_str.size() || checkpoint_file.size() ) {
+    ap.error( "Cannot restrict or resume a spliced search" );
+    return false;
+  }
+  if ( changes_of_method.first > changes_of_method.second ) {
+    ap.error( "The minimum number of changes of method is greater than "
+              "the maximum" );
+    return false;
+  }
+
+  for ( vector<string>::const_iterator
+          i( splice_strs.begin() ), e( splice_strs.end() ); i != e; ++i )
+    try {
+      size_t const eq = i->find('=');
+      string const label = eq == string::npos 
+        ? string( 1, char( 'A' + splice_meths.size() ) ) : i->substr(0, eq);
+      string const pn = eq == string::npos ? *i : i->substr(eq+1);
+
+      splice_meths.push_back( method( pn, bells, label ) );
+      splice_labels.push_back( label );
+    }
+    catch ( exception const& ex ) {
+      ap.error( make_string() << "Unable to parse method '"
+                << *i << "': " << ex.what() );
+      return false;
+    }
+
+  // So that the checks on the method below are made
+  meth = splice_meths.front();
+  return true;
+}
+
+bool arguments::generate_music( arg_parser& ap )
+{
+  if ( music_strs.empty() ) 
+    return true;
+
+  if ( use_plan ) {
+    ap.error( "Cannot score touches when using a plan" );
+    return false;
+  }
+
+  if ( best < 0 ) {
+    ap.error( "The number of touches to output must not be negative" );
+    return false;
+  }
+
+  mus = music( bells );
+  for ( vector<string>::const_iterator
+          i( music_strs.begin() ), e( music_strs.end() ); i != e; ++i )
+    try {
+      add_scored_music_string( mus, *i );
+    }
+    catch ( exception const& ex ) {
+      ap.error( make_string() << "Unable to parse music '"
+                << *i << "': " << ex.what() );
+      return false;
+    }
+
+  return true;
+}
+
+bool arguments::generate_range( arg_parser& ap )
+{
+  try {
+    from = search_base::parse_position( from_str );
+    to = search_base::parse_position( to_str );
+  }
+  catch ( exception const& ex ) {
+    ap.error( ex.what() );
+    return false;
+  }
+
+  if ( to.size() && to <= from ) {
+    ap.error( "The end of the search must come after its start" );
+    return false;
+  }
+
+  if ( checkpoint_file.size() ) {
+    if ( filter_mode ) {
+      ap.error( "Cannot save checkpoints when running as a filter" );
+      return false;
+    }
+    if ( threads != 1 && !in_order ) {
+      ap.error( "Saving checkpoints with several threads requires "
+                "--in-order" );
+      return false;
+    }
+  }
+
+  return true;
+}
+
 bool arguments::generate_pends( arg_parser& ap )
 {
   vector<row> gens;
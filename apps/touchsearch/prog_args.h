@@ -29,6 +29,7 @@
 #include <ringing/change.h>
 #include <ringing/method.h>
 #include <ringing/group.h>
+#include <ringing/music.h>
 #include "init_val.h"
 #include <string>
 #if RINGING_OLD_INCLUDES
@@ -36,6 +37,11 @@
 #else
 #include <vector>      
 #endif
+#if RINGING_OLD_C_INCLUDES
+#include <limits.h>
+#else
+#include <climits>
+#endif
 
 class arg_parser;
 
@@ -48,16 +54,26 @@ struct arguments
 
   pair<size_t,size_t>  length;
   init_val<bool,false> ignore_rotations;
+  init_val<bool,false> ignore_reversals;
+  init_val<bool,false> ignore_conjugates;
   init_val<bool,false> mutually_true_parts;
   
   init_val<int,-1>     search_limit;
   init_val<bool,false> filter_mode;
   init_val<bool,false> quiet;
+  init_val<bool,false> status;
+  init_val<int,1>      status_interval;
   init_val<bool,false> count;
   init_val<bool,false> raw_count;
   init_val<bool,false> comma_separate;
   init_val<bool,false> use_plan;
   init_val<bool,true>  round_blocks;
+  init_val<int,1>      threads;
+  init_val<bool,false> in_order;
+
+  string               from_str, to_str;
+  vector<size_t>       from, to;
+  string               checkpoint_file;
 
   string               plain_name;
   string               meth_str;
@@ -69,6 +85,16 @@ struct arguments
   vector<string>       pend_strs;
   group                pends;
 
+  vector<string>       splice_strs;
+  vector<string>       splice_labels;
+  vector<method>       splice_meths;
+  pair<size_t,size_t>  changes_of_method;
+
+  vector<string>       music_strs;
+  music                mus;
+  init_val<int,10>     best;
+  init_val<int,INT_MIN> min_score;
+
   arguments( int argc, char** argv );
 
 private:
@@ -76,6 +102,9 @@ private:
   bool validate( arg_parser& p );
   bool generate_calls( arg_parser& ap );
   bool generate_pends( arg_parser& ap );
+  bool generate_range( arg_parser& ap );
+  bool generate_music( arg_parser& ap );
+  bool generate_splice( arg_parser& ap );
 };
 
 // TODO:  This doesn't belong here!
@@ -0,0 +1,135 @@
+// -*- C++ -*- searchbench.cpp - time some touch searches
+// Copyright (C) 2014 Richard Smith <richard@ex-parrot.com>
+
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+// $Id$
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <ctime>
+#include <cstdlib>
+#include <ringing/row.h>
+#include <ringing/method.h>
+#include <ringing/group.h>
+#include <ringing/touch.h>
+#include <ringing/table_search.h>
+#include <ringing/basic_search.h>
+
+#if RINGING_USE_NAMESPACES
+using namespace ringing;
+#endif
+
+// Counts the touches found without looking at them
+class touch_counter : public search_base::outputer
+{
+public:
+  touch_counter() : n(0) {}
+  virtual bool operator()( const touch & ) { ++n; return false; }
+  virtual bool operator()( const search_base::call_sequence & ) 
+    { ++n; return false; }
+  unsigned long n;
+};
+
+void bench( const char *desc, const method &m, const char *call_pns, 
+            const group &partends, size_t max_len, int sym, unsigned threads )
+{
+  vector<change> calls;
+  for ( string s( call_pns ); !s.empty(); ) {
+    string::size_type i = s.find(' ');
+    calls.push_back( change( m.bells(), s.substr(0, i) ) );
+    s.erase( 0, i == string::npos ? i : i+1 );
+  }
+
+  table_search::flags f = static_cast<table_search::flags>
+    ( table_search::length_in_changes | sym );
+  table_search s( m, calls, partends, make_pair( size_t(0), max_len ), f );
+
+  touch_counter c;
+  clock_t const start = clock();
+  s.run( c, threads );
+  double const secs = double( clock() - start ) / CLOCKS_PER_SEC;
+
+  cout << setw(40) << left << desc << setw(10) << right << c.n 
+       << " touches" << setw(10) << fixed << setprecision(2) << secs 
+       << "s" << endl;
+}
+
+// basic_search keeps its leads in a hash set, without a multiplication
+// table, so its lengths are in leads
+void bench_basic( const char *desc, const method &m, size_t max_leads )
+{
+  vector<change> calls;
+  calls.push_back( change( m.bells(), "14" ) );
+  calls.push_back( change( m.bells(), "1234" ) );
+  basic_search s( m, calls, make_pair( size_t(0), max_leads ), true );
+
+  touch_counter c;
+  clock_t const start = clock();
+  s.run( c );
+  double const secs = double( clock() - start ) / CLOCKS_PER_SEC;
+
+  cout << setw(40) << left << desc << setw(10) << right << c.n 
+       << " touches" << setw(10) << fixed << setprecision(2) << secs 
+       << "s" << endl;
+}
+
+int main( int argc, char *argv[] )
+{
+  // The number of threads can be given on the command line.  CPU time
+  // is reported, so this is mainly useful to measure the overhead of 
+  // splitting a search.
+  unsigned const threads = argc > 1 ? atoi( argv[1] ) : 1;
+
+  method const bob6( "&-16-16-16,12", 6 ),
+    yorkshire8( "&-38-14-1258-36-14-58-16-78,12", 8 ),
+    yorkshire10( "&-30-14-1250-36-1470-58-16-70-18-90,12", 10 );
+
+  int const rot = table_search::ignore_rotations,
+    sym = rot | table_search::ignore_reversals;
+
+  bench( "Bob Minor, bobs and singles, 288", bob6, "14 1234",
+         group( row(6) ), 288, rot, threads );
+  bench( "Yorkshire Major, bobs and singles, 576", yorkshire8, "14 1234",
+         group( row(8) ), 576, rot, threads );
+  bench( "Yorkshire Major, 3-part, bobs, 2688", yorkshire8, "14",
+         group( row("13425678") ), 2688, 0, threads );
+  bench( "Yorkshire Royal, bobs and singles, 600", yorkshire10, "14 1234",
+         group( row(10) ), 600, rot, threads );
+
+  bench_basic( "Yorkshire Royal, basic_search, 14 leads", yorkshire10, 14 );
+  bench_basic( "Yorkshire Maximus, basic_search, 12 leads", 
+               method( "&-3T-14-125T-36-147T-58-169T-70-18-9T-10-ET,12", 12 ),
+               12 );
+
+  // The effect of pruning symmetries from multipart searches.  The part
+  // ends are normalised by the lead end, so reversals can be pruned.
+  bench( "Yorkshire Major, 3-part, b & s, 1536", yorkshire8, "14 1234",
+         group( row("13542678") ), 1536, 0, threads );
+  bench( "  ... without rotations", yorkshire8, "14 1234",
+         group( row("13542678") ), 1536, rot, threads );
+  bench( "  ... or reversals", yorkshire8, "14 1234",
+         group( row("13542678") ), 1536, sym, threads );
+  bench( "Yorkshire Major, 5-part, b & s, 2560", yorkshire8, "14 1234",
+         group( row("13527648") ), 2560, 0, threads );
+  bench( "  ... without rotations", yorkshire8, "14 1234",
+         group( row("13527648") ), 2560, rot, threads );
+  bench( "  ... or reversals", yorkshire8, "14 1234",
+         group( row("13527648") ), 2560, sym, threads );
+
+  return 0;
+}
@@ -0,0 +1,113 @@
+// -*- C++ -*- touchbench.cpp - time iterating over the rows of a touch
+// Copyright (C) 2014 Richard Smith <richard@ex-parrot.com>
+
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+// $Id$
+
+#include <iostream>
+#include <iomanip>
+#include <ctime>
+#include <cstdlib>
+#include <ringing/row.h>
+#include <ringing/touch.h>
+
+#if RINGING_USE_NAMESPACES
+using namespace ringing;
+#endif
+
+// 5040 changes of Plain Bob Triples, built as gsiril would: five parts
+// of six courses, each course with its calls in the same places
+touch make_touch()
+{
+  touch t;
+
+  touch_changes *lead, *plain, *bob;
+  t.push_back( lead  = new touch_changes( "&7.1.7.1.7.1.7", 7 ) );
+  t.push_back( plain = new touch_changes( "127", 7 ) );
+  t.push_back( bob   = new touch_changes( "147", 7 ) );
+
+  touch_child_list *p, *b, *course, *part, *head;
+  t.push_back( p      = new touch_child_list );
+  t.push_back( b      = new touch_child_list );
+  t.push_back( course = new touch_child_list );
+  t.push_back( part   = new touch_child_list );
+  t.push_back( head   = new touch_child_list );
+
+  p->push_back( 1, lead );  p->push_back( 1, plain );
+  b->push_back( 1, lead );  b->push_back( 1, bob );
+  course->push_back( 2, p );  course->push_back( 1, b );
+  course->push_back( 3, p );  course->push_back( 1, b );
+  course->push_back( 5, p );
+  part->push_back( 6, course );
+  head->push_back( 5, part );
+  t.set_head( head );
+
+  return t;
+}
+
+double seconds( clock_t start )
+{
+  return double( clock() - start ) / CLOCKS_PER_SEC;
+}
+
+void report( const char *desc, size_t rows, double secs, int reps )
+{
+  cout << setw(40) << left << desc << setw(10) << right << rows 
+       << " rows" << setw(10) << fixed << setprecision(3) << secs 
+       << "s" << setw(10) << setprecision(2) << ( secs ? reps / secs : 0 )
+       << "/s" << endl;
+}
+
+int main( int argc, char *argv[] )
+{
+  int const reps = argc > 1 ? atoi( argv[1] ) : 1000;
+  touch const t( make_touch() );
+
+  // Walk the touch node iterators, applying each change to a row
+  size_t rows = 0;
+  {
+    clock_t const start = clock();
+    for ( int n = 0; n < reps; ++n ) {
+      row r( 7 );
+      for ( touch::const_iterator i( t.begin() ), e( t.end() ); i != e; ++i )
+        r *= *i, ++rows;
+    }
+    report( "touch::const_iterator", rows / reps, seconds( start ), reps );
+  }
+
+  // Compile the touch, once, and generate its rows into a row_matrix
+  {
+    clock_t const start = clock();
+    compiled_touch const ct( t.compile() );
+    report( "touch::compile", ct.size(), seconds( start ), 1 );
+  }
+  {
+    compiled_touch const ct( t.compile() );
+    row_matrix m( ct.bells() );
+    m.reserve( ct.size() );
+
+    clock_t const start = clock();
+    rows = 0;
+    for ( int n = 0; n < reps; ++n ) {
+      m.clear();
+      ct.rows( m );
+      rows += m.size();
+    }
+    report( "compiled_touch::rows", rows / reps, seconds( start ), reps );
+  }
+
+  return 0;
+}
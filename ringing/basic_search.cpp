@@ -25,8 +25,10 @@
 
 #if RINGING_OLD_INCLUDES
 #include <set.h>
+#include <vector.h>
 #else
 #include <set>
+#include <vector>
 #endif
 #include <ringing/search_base.h>
 #include <ringing/basic_search.h>
@@ -37,6 +39,192 @@ RINGING_START_NAMESPACE
 
 RINGING_USING_STD
 
+RINGING_START_ANON_NAMESPACE
+
+// The leads had so far, as a set of rows.  This works on any number of
+// bells.
+class row_leads
+{
+public:
+  typedef row row_type;
+
+  row_leads( const vector< row > &call_lhs, const falseness_table &f )
+    : call_lhs( call_lhs ), falsenesses( f ) {}
+
+  row_type rounds() const { return row( call_lhs.front().bells() ); }
+  row_type next( const row_type &r, size_t call ) const
+    { return r * call_lhs[call]; }
+  bool is_rounds( const row_type &r ) const { return r.isrounds(); }
+
+  bool is_false( const row_type &r ) const
+  {
+    for ( falseness_table::const_iterator i( falsenesses.begin() ); 
+	  i != falsenesses.end(); ++i )
+      if ( leads.count( r * *i ) )
+	return true;
+
+    return false;
+  }
+
+  void insert( const row_type &r ) { leads.insert( r ); }
+  void erase( const row_type &r ) { leads.erase( r ); }
+
+private:
+  const vector< row > &call_lhs;
+  const falseness_table &falsenesses;
+  set< row > leads;
+};
+
+// Rows on up to sixteen bells are packed four bits to a bell, with the
+// first bell in the most significant position, as in falseness.cpp.
+typedef RINGING_ULLONG packed_row;
+size_t const max_packed_bells = 16;
+
+packed_row pack( const row &r )
+{
+  packed_row p = 0;
+  for ( int j = 0; j < r.bells(); ++j )
+    p = p << 4 | packed_row( r[j] );
+  return p;
+}
+
+// A permutation that multiplies packed rows on the right.  As
+// (r * f)[j] == r[ f[j] ], it is the amount to shift r by to bring
+// each of its bells r[ f[j] ] to the bottom.
+class packed_perm
+{
+public:
+  explicit packed_perm( const row &f ) : b( f.bells() )
+  {
+    for ( size_t j = 0; j < b; ++j )
+      shifts[j] = 4 * ( b-1 - f[j] );
+  }
+
+  packed_row operator()( packed_row r ) const
+  {
+    packed_row p = 0;
+    for ( size_t j = 0; j < b; ++j )
+      p = p << 4 | ( r >> shifts[j] & 0xF );
+    return p;
+  }
+
+private:
+  size_t b;
+  unsigned char shifts[ max_packed_bells ];
+};
+
+// A set of packed rows, using open addressing with linear probing.  
+// As no row packs to zero, that marks an empty slot.
+class packed_row_set
+{
+public:
+  packed_row_set() : slots( 64 ), n(0) {}
+
+  bool count( packed_row r ) const
+  {
+    size_t const mask = slots.size() - 1;
+    for ( size_t i = hash(r) & mask; slots[i]; i = (i+1) & mask )
+      if ( slots[i] == r ) 
+	return true;
+    return false;
+  }
+
+  void insert( packed_row r )
+  {
+    if ( 2 * (n+1) > slots.size() ) grow();
+    size_t const mask = slots.size() - 1;
+    size_t i = hash(r) & mask;
+    for ( ; slots[i]; i = (i+1) & mask )
+      if ( slots[i] == r ) 
+	return;
+    slots[i] = r;  ++n;
+  }
+
+  void erase( packed_row r )
+  {
+    size_t const mask = slots.size() - 1;
+    size_t i = hash(r) & mask;
+    for ( ; slots[i] != r; i = (i+1) & mask )
+      if ( !slots[i] ) 
+	return;
+
+    // Move back any later row in the same run whose probe sequence 
+    // starts at or before the gap, so that lookups still find it
+    for ( size_t j = (i+1) & mask; slots[j]; j = (j+1) & mask ) {
+      size_t const k = hash( slots[j] ) & mask;
+      if ( i <= j ? ( k <= i || k > j ) : ( k <= i && k > j ) ) {
+	slots[i] = slots[j];
+	i = j;
+      }
+    }
+    slots[i] = 0;  --n;
+  }
+
+private:
+  static size_t hash( packed_row r )
+  {
+    r ^= r >> 29;
+    r *= packed_row( 0x9E3779B1u );
+    return size_t( r ^ r >> 32 );
+  }
+
+  void grow()
+  {
+    vector< packed_row > old( 2 * slots.size() );
+    old.swap( slots );  n = 0;
+    for ( vector< packed_row >::const_iterator i( old.begin() );
+	  i != old.end(); ++i )
+      if ( *i ) insert( *i );
+  }
+
+  vector< packed_row > slots;
+  size_t n;
+};
+
+// The leads had so far, as packed rows, for searches on up to sixteen
+// bells.  This avoids allocating a row for each product with a false 
+// lead head and walking a tree to look it up.
+class packed_leads
+{
+public:
+  typedef packed_row row_type;
+
+  packed_leads( const vector< row > &call_lhs, const falseness_table &f )
+    : rounds_row( pack( row( call_lhs.front().bells() ) ) )
+  {
+    for ( vector< row >::const_iterator i( call_lhs.begin() ); 
+	  i != call_lhs.end(); ++i )
+      calls.push_back( packed_perm( *i ) );
+    for ( falseness_table::const_iterator i( f.begin() ); i != f.end(); ++i )
+      falsenesses.push_back( packed_perm( *i ) );
+  }
+
+  row_type rounds() const { return rounds_row; }
+  row_type next( row_type r, size_t call ) const { return calls[call](r); }
+  bool is_rounds( row_type r ) const { return r == rounds_row; }
+
+  bool is_false( row_type r ) const
+  {
+    for ( vector< packed_perm >::const_iterator i( falsenesses.begin() ); 
+	  i != falsenesses.end(); ++i )
+      if ( leads.count( (*i)(r) ) )
+	return true;
+
+    return false;
+  }
+
+  void insert( row_type r ) { leads.insert( r ); }
+  void erase( row_type r ) { leads.erase( r ); }
+
+private:
+  row_type rounds_row;
+  vector< packed_perm > calls;		// The effect of each call
+  vector< packed_perm > falsenesses;	// The false lead heads
+  packed_row_set leads;
+};
+
+RINGING_END_ANON_NAMESPACE
+
 basic_search::basic_search( const method &meth, const vector<change> &calls,
 			    bool ignore_rotations )
   : meth( meth ), calls( calls ), 
@@ -58,7 +246,8 @@ class basic_search::context : public search_base::context_base
 public:
   context( const basic_search *s ) 
     : lenrange( s->lenrange ),
-      ignore_rotations( s->ignore_rotations )
+      ignore_rotations( s->ignore_rotations ),
+      meter( *s )
   {
     row le; 
     for_each( s->meth.begin(), s->meth.end()-1, permute(le) );
@@ -115,18 +304,15 @@ private:
   virtual void run( outputer &output ) 
   {
     force_halt = false;
-    leads.clear();
-    run_recursive( output, row( call_lhs.front().bells() ), 0, 0 );
-  }
-
-  bool is_row_false( const row &r )
-  {
-    for ( falseness_table::const_iterator i( falsenesses.begin() ); 
-	  i != falsenesses.end(); ++i )
-      if ( leads.count( r * *i ) )
-	return true;
-
-    return false;
+    meter.start();
+    if ( size_t( call_lhs.front().bells() ) <= max_packed_bells ) {
+      packed_leads leads( call_lhs, falsenesses );
+      run_recursive( output, leads, leads.rounds(), 0, 0 );
+    } else {
+      row_leads leads( call_lhs, falsenesses );
+      run_recursive( output, leads, leads.rounds(), 0, 0 );
+    }
+    meter.report( output );
   }
 
   // Output the current touch and any rotations of it.
@@ -142,6 +328,7 @@ private:
       tl->push_back( 1, t.get_node( 2 * (1 + calls[i]) ) );
 
     force_halt = output( t );
+    ++meter.stats.touches;
 
     if ( ! ignore_rotations )
       for ( size_t start = 1; !force_halt && start < len / parts; ++start )
@@ -149,6 +336,7 @@ private:
 	  // Try all of it's distinguishable rotations.
 	  ch.splice( ch.end(), ch, ch.begin() );
 	  force_halt = output( t );
+          ++meter.stats.touches;
 	}
   }
 
@@ -182,18 +370,34 @@ private:
     return true;
   }
 
-  // The main loop of the algorithm   
-  void run_recursive( outputer &output, const row &r, size_t depth, size_t cur ) 
+  // The main loop of the algorithm, with the leads had so far kept in
+  // a row_leads or packed_leads
+  template < class Leads >
+  void run_recursive( outputer &output, Leads &leads, 
+		      const typename Leads::row_type &r, 
+		      size_t depth, size_t cur ) 
   {
+    statistics &st = meter.stats;
+    if ( ++st.nodes % poll_interval == 0 && meter.due() )
+      meter.report( output );
+
+    if ( depth >= st.depths.size() ) st.depths.resize( depth + 1 );
+    ++st.depths[depth];
+
     // Is the touch lexicographically no greater than any of it's rotations?
-    if ( !is_possibly_canonical( cur ) )
+    if ( !is_possibly_canonical( cur ) ) {
+      ++st.non_canonical;
       return;
+    }
 
     // Is the going to repeat?
-    if ( is_row_false( r ) )
+    if ( leads.is_false( r ) )
       {
+        ++st.false_nodes;
+
 	// Has it come round, and is it in it's canonical form?
-	if ( depth >= lenrange.first && r.isrounds() && is_really_canonical() )
+	if ( depth >= lenrange.first && leads.is_rounds( r ) 
+	     && is_really_canonical() )
 	  output_touches( output, cur );
 
       }
@@ -204,13 +408,15 @@ private:
 	
 	for ( ; !force_halt && calls.back() < call_lhs.size(); ++calls.back() )
 	  {
-	    run_recursive( output, r * call_lhs[ calls.back() ], 
+	    run_recursive( output, leads, leads.next( r, calls.back() ), 
 			   depth + 1, cur );
 	  }
 	
 	calls.pop_back();
 	leads.erase( r );
       }
+    else
+      ++st.too_long;
   }
   
 private:
@@ -222,11 +428,16 @@ private:
   touch_child_list *tl;
   bool ignore_rotations;		// Are we to ignore rotations?
 
-  set< row > leads;			// The leads had so far
   vector< row > call_lhs;		// The effect of each call (inc. plain)
   falseness_table falsenesses;		// The falsenesses of the method
+  progress_meter meter;			// Statistics for the run
+
+  // How often to check whether a progress report is due
+  static size_t const poll_interval = 4096;
 };
 
+size_t const basic_search::context::poll_interval;
+
 search_base::context_base *basic_search::new_context() const 
 { 
   return new context( this );
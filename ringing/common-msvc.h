@@ -92,4 +92,8 @@
 // *** Define this to be 1 if you have long long
 #define RINGING_HAVE_LONG_LONG 1
 
+// *** Define this to be 1 if you want to use POSIX threads to run some
+// algorithms in parallel, or 0 otherwise.
+#define RINGING_USE_THREADS 0
+
 #endif // RINGING_COMMON_MSVC_H
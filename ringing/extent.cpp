@@ -60,9 +60,7 @@ extent_iterator::extent_iterator( unsigned int nw, unsigned int nh )
 
 extent_iterator &extent_iterator::operator++()
 {
-  vector<bell> v; r.swap(v);
-  end_ = ! next_permutation( v.begin() + nh, v.begin() + nh + nw );
-  if (!end_) r.swap(v);
+  end_ = ! r.next_permutation( nh, nh + nw );
   return *this;
 }
 
@@ -76,9 +74,7 @@ extent_iterator &extent_iterator::operator--()
     r.swap(v);
   } 
   else {
-    vector<bell> v; r.swap(v);
-    prev_permutation( v.begin() + nh, v.begin() + nh + nw );
-    r.swap(v);
+    r.prev_permutation( nh, nh + nw );
   }
   return *this;
 }
@@ -97,6 +93,17 @@ extent_iterator extent_iterator::end( unsigned nw, unsigned nh, unsigned nt )
   return e;
 }
 
+extent_iterator 
+extent_iterator::at( size_t n, unsigned nw, unsigned nh, unsigned nt )
+{
+  if ( n == factorial(nw) ) 
+    return end(nw, nh, nt);
+
+  extent_iterator i(nw, nh, nt);
+  i.r = nth_row_of_extent(n, nw, nh, nt);
+  return i;
+}
+
 RINGING_API size_t
 position_in_extent( row const& r, unsigned nw, unsigned nh, unsigned nt )
 {
@@ -184,28 +191,142 @@ size_t extent::size() const
   return factorial(nw); 
 }
 
+RINGING_START_ANON_NAMESPACE
+
+// Find the range [first, last) of the kth of n nearly equal parts of 
+// [0, sz).  The first sz % n parts have one extra element.
+void chunk_bounds( size_t sz, size_t k, size_t n, 
+                   size_t& first, size_t& last )
+{
+  size_t const q = sz / n, rem = sz % n;
+  first = k * q + ( k < rem ? k : rem );
+  last = first + q + ( k < rem ? 1 : 0 );
+}
+
+RINGING_END_ANON_NAMESPACE
+
+extent::chunk_type extent::chunk( size_t k, size_t n ) const
+{
+  size_t first, last;
+  chunk_bounds( size(), k, n, first, last );
+  return chunk_type( nw, nh, nt, first, last );
+}
+
+extent_iterator extent::chunk_type::begin() const
+{
+  return extent_iterator::at( first, nw, nh, nt );
+}
+
+extent_iterator extent::chunk_type::end() const
+{
+  return extent_iterator::at( last, nw, nh, nt );
+}
+
+row extent::chunk_type::operator[]( size_t n ) const
+{
+  return nth_row_of_extent( first + n, nw, nh, nt );
+}
+
 
 RINGING_API row
 nth_row_of_incourse_extent( size_t n, unsigned nw, unsigned nh, unsigned nt )
 {
-  row r( nth_row_of_extent( n*2, nw, nh, nt ) );
-  if ( r.sign() < 0 ) {
-    change c(nt); 
-    c.swappair(nw+nh-2); 
-    r *= c;
-  }
-  return r;
+  // Rows 2n and 2n+1 of the extent differ only by a swap of the last two
+  // working bells, so exactly one of them is in-course.
+  return nth_row_of_extent( sign_of_nth_row_of_extent(n*2) < 0 ? n*2+1 : n*2,
+                            nw, nh, nt );
+}
+
+RINGING_START_ANON_NAMESPACE
+
+// Does the step from the (n-1)th to the nth row of the extent change 
+// parity?  next_permutation swaps one bell into place and reverses the 
+// t bells after it, where t is the largest integer such that t! divides n.  
+bool step_changes_parity( size_t n )
+{
+  size_t t = 1;
+  while ( n % (t+1) == 0 ) n /= ++t;
+  return ( 1 + t/2 ) % 2;
 }
 
+RINGING_END_ANON_NAMESPACE
+
+void incourse_extent_iterator::next()
+{
+  ++ei; ++n;
+  if ( step_changes_parity(n) ) odd = !odd;
+}
 
 incourse_extent_iterator &incourse_extent_iterator::operator++() 
 {
+  // As rows 2k and 2k+1 of the extent have opposite parities, at most
+  // three steps are needed.
   do { 
-    ++ei; 
-  } while ( !ei.is_end() && ei->sign() < 0);
+    next();
+  } while ( !ei.is_end() && odd );
   return *this;
 }
 
+incourse_extent_iterator 
+incourse_extent_iterator::at( size_t n, unsigned nw, unsigned nh, unsigned nt )
+{
+  incourse_extent_iterator i;
+  if ( n == incourse_extent(nw, nh, nt).size() ) 
+    i.ei = extent_iterator::end(nw, nh, nt);
+  else {
+    i.n = sign_of_nth_row_of_extent(n*2) < 0 ? n*2+1 : n*2;
+    i.ei = extent_iterator::at(i.n, nw, nh, nt);
+  }
+  return i;
+}
+
+incourse_extent_iterator incourse_extent::begin() const
+{
+  return incourse_extent_iterator(nw, nh, nt); 
+}
+
+incourse_extent_iterator incourse_extent::end() const
+{ 
+  return incourse_extent_iterator(); 
+}
+
+row incourse_extent::operator[]( size_t n ) const 
+{
+  return nth_row_of_incourse_extent(n, nw, nh, nt);
+}
+
+size_t incourse_extent::operator[]( row r ) const
+{
+  return position_in_incourse_extent( r, nw, nh, nt );
+}
+
+size_t incourse_extent::size() const
+{
+  return nw < 2 ? 1 : factorial(nw) / 2; 
+}
+
+incourse_extent::chunk_type incourse_extent::chunk( size_t k, size_t n ) const
+{
+  size_t first, last;
+  chunk_bounds( size(), k, n, first, last );
+  return chunk_type( nw, nh, nt, first, last );
+}
+
+incourse_extent_iterator incourse_extent::chunk_type::begin() const
+{
+  return incourse_extent_iterator::at( first, nw, nh, nt );
+}
+
+incourse_extent_iterator incourse_extent::chunk_type::end() const
+{
+  return incourse_extent_iterator::at( last, nw, nh, nt );
+}
+
+row incourse_extent::chunk_type::operator[]( size_t n ) const
+{
+  return nth_row_of_incourse_extent( first + n, nw, nh, nt );
+}
+
 void changes_iterator::next()
 {
   if ( nw == 0 || stk.size() == nw && stk.back() == nw+nh-1 )
@@ -230,6 +351,68 @@ void changes_iterator::next()
     }
 }
 
+plain_changes_iterator::plain_changes_iterator( unsigned int nw, 
+                                                unsigned int nh, 
+                                                unsigned int nt )
+  : nw(nw), nh(nh), end_(false), last(false), r(nt), p(0), 
+    c(nw+1, 0), o(nw+1, 1)
+{
+  init(nt);
+}
+
+plain_changes_iterator::plain_changes_iterator( unsigned int nw, 
+                                                unsigned int nh )
+  : nw(nw), nh(nh), end_(false), last(false), r(nw+nh), p(0), 
+    c(nw+1, 0), o(nw+1, 1)
+{
+  init(nw+nh);
+}
+
+void plain_changes_iterator::init( unsigned int nt )
+{
+  if ( nw < 2 ) 
+    chs.push_back( change(nt) );
+  else for ( unsigned i=0; i<nw-1; ++i ) {
+    chs.push_back( change(nt) );
+    chs.back().swappair(nh+i);
+  }
+  find_next();
+}
+
+// Steps P3 to P7 of Algorithm P, except that the swap in P5 is deferred
+// until the iterator is incremented, so that next_change() is known.  
+// The arrays are indexed from 1, as in Knuth's presentation.
+void plain_changes_iterator::find_next()
+{
+  int j = nw, s = 0;
+  while ( j > 1 ) {
+    int const q = c[j] + o[j];
+    if ( q == j ) 
+      ++s;
+    else if ( q >= 0 ) {
+      p = min( j - c[j], j - q ) + s - 1;
+      c[j] = q;
+      return;
+    }
+    o[j] = -o[j];  --j;
+  }
+
+  // The last row: the closing change swaps the first two working bells
+  last = true; 
+  p = 0;
+}
+
+plain_changes_iterator &plain_changes_iterator::operator++()
+{
+  if ( last ) 
+    end_ = true;
+  else {
+    r *= chs[p];
+    find_next();
+  }
+  return *this;
+}
+
 changes_iterator::changes_iterator( unsigned int nw, unsigned int nh )
   : nw(nw), nh(nh), end_(false), c(nw+nh)
 {
@@ -42,6 +42,7 @@
 #endif
 #include <ringing/row.h>
 #include <ringing/change.h>
+#include <ringing/parallel.h>
 
 #if RINGING_BACKWARDS_COMPATIBLE(0,3,0)
 #include <ringing/mathutils.h>
@@ -110,6 +111,10 @@ public:
   static extent_iterator end( unsigned nw, unsigned nh = 0)
     { return end(nw, nh, nw+nh);  }
 
+  // An iterator to the nth row of the extent, or the end iterator if 
+  // n is nw!.  This is O(nw^2), after which iteration continues as usual.
+  static extent_iterator at( size_t n, unsigned nw, unsigned nh, unsigned nt );
+
 private:
   struct bellsym_cmp;
 
@@ -171,13 +176,48 @@ public:
   // Get nth row and corresponding reverse map
   row operator[]( size_t n ) const;
   size_t operator[]( row r ) const;
+
+  // The kth of n contiguous parts of the extent, of as nearly equal a
+  // size as possible.  This is useful for dividing the extent between
+  // threads: see parallel_for_each_row, below.
+  class chunk_type;
+  chunk_type chunk( size_t k, size_t n ) const;
  
 private:
   unsigned nw, nh, nt;
 };
 
+class RINGING_API extent::chunk_type {
+public:
+  typedef row       value_type;
+  typedef size_t    size_type;
+  typedef ptrdiff_t difference_type;
+
+  typedef extent_iterator const_iterator;
+  extent_iterator begin() const;
+  extent_iterator end() const;
+  size_t size() const { return last - first; }
+
+  // The position in the extent of the first row in the chunk
+  size_t offset() const { return first; }
 
-// Generate the in-course half-extent in lexicographical order
+  // Random access, in O(nw^2) time
+  row operator[]( size_t n ) const;
+
+private:
+  friend class extent;
+  chunk_type( unsigned nw, unsigned nh, unsigned nt, 
+              size_t first, size_t last )
+    : nw(nw), nh(nh), nt(nt), first(first), last(last) {}
+
+  unsigned nw, nh, nt;
+  size_t first, last;
+};
+
+
+// Generate the in-course half-extent in lexicographical order.  The odd
+// rows are skipped without their parity needing to be calculated, so this
+// is nearly as fast as extent_iterator.
 class RINGING_API incourse_extent_iterator
   : public RINGING_STD_CONST_ITERATOR( forward_iterator_tag, row )
 {
@@ -190,7 +230,7 @@ public:
   typedef const row &reference;
 
   // The end iterator
-  incourse_extent_iterator() {}
+  incourse_extent_iterator() : n(0), odd(false) {}
  
   // The beginning iterator
   //   nw == The number of working bells 
@@ -199,9 +239,9 @@ public:
   // E.g. The set of tenors together lead heads, "1xxxxx78", has 
   // nw = 5, nh = 1, nt = 8.
   incourse_extent_iterator( unsigned int nw, unsigned int nh, unsigned int nt )
-    : ei( nw, nh, nt ) {}
+    : ei( nw, nh, nt ), n(0), odd(false) {}
   explicit incourse_extent_iterator( unsigned int nw, unsigned int nh = 0u )
-    : ei( nw, nh ) {}
+    : ei( nw, nh ), n(0), odd(false) {}
 
   // Trivial Iterator implementation
   const row *operator->() const { return &*ei; }
@@ -218,8 +258,19 @@ public:
   incourse_extent_iterator operator++(int)
     { incourse_extent_iterator tmp(*this); ++*this; return tmp; }
 
+  bool is_end() const { return ei.is_end(); }
+
+  // An iterator to the nth row of the in-course half-extent, or the end
+  // iterator if n is nw!/2.  
+  static incourse_extent_iterator 
+  at( size_t n, unsigned nw, unsigned nh, unsigned nt );
+
 private:
+  void next();
+
   extent_iterator ei;
+  size_t n;       // The position of *ei in the whole extent
+  bool odd;       // Is *ei an odd row?
 };
 
 // Find the position of the row in an in-course half-extent 
@@ -250,6 +301,170 @@ nth_row_of_incourse_extent( size_t n, unsigned nw, unsigned nh = 0 ) {
   return nth_row_of_incourse_extent( n, nw, nh, nw+nh );
 }
 
+// A pseudo-container class representing the in-course half-extent.
+// This is the analogue of extent, but for the nw!/2 even rows: it 
+// allows tables of in-course rows to be indexed densely.
+class RINGING_API incourse_extent {
+public:
+  typedef row       value_type;
+  typedef size_t    size_type;
+  typedef ptrdiff_t difference_type;
+
+  explicit incourse_extent( unsigned nw, unsigned nh = 0 ) 
+    : nw(nw), nh(nh), nt(nw+nh) {}
+  incourse_extent( unsigned nw, unsigned nh, unsigned nt )
+    : nw(nw), nh(nh), nt(nt) {}
+
+  typedef incourse_extent_iterator const_iterator;
+  incourse_extent_iterator begin() const;
+  incourse_extent_iterator end() const;
+  size_t size() const;
+
+  // A less-than comparator for lexicographical ordering
+  typedef less<row> compare;
+
+  // Get nth row and corresponding reverse map
+  row operator[]( size_t n ) const;
+  size_t operator[]( row r ) const;
+
+  // The kth of n contiguous parts of the half-extent: see extent::chunk.
+  class chunk_type;
+  chunk_type chunk( size_t k, size_t n ) const;
+ 
+private:
+  unsigned nw, nh, nt;
+};
+
+class RINGING_API incourse_extent::chunk_type {
+public:
+  typedef row       value_type;
+  typedef size_t    size_type;
+  typedef ptrdiff_t difference_type;
+
+  typedef incourse_extent_iterator const_iterator;
+  incourse_extent_iterator begin() const;
+  incourse_extent_iterator end() const;
+  size_t size() const { return last - first; }
+
+  // The position in the half-extent of the first row in the chunk
+  size_t offset() const { return first; }
+
+  // Random access, in O(nw^2) time
+  row operator[]( size_t n ) const;
+
+private:
+  friend class incourse_extent;
+  chunk_type( unsigned nw, unsigned nh, unsigned nt, 
+              size_t first, size_t last )
+    : nw(nw), nh(nh), nt(nt), first(first), last(last) {}
+
+  unsigned nw, nh, nt;
+  size_t first, last;
+};
+
+RINGING_START_DETAILS_NAMESPACE
+
+template <class Extent, class Function>
+class extent_rows_task : public parallel_task
+{
+public:
+  extent_rows_task( Extent const& e, size_t n, Function& f ) 
+    : e(e), n(n), f(f) {}
+
+  virtual void run( size_t k ) {
+    typename Extent::chunk_type const c( e.chunk(k, n) );
+    size_t i = c.offset();
+    for ( typename Extent::const_iterator j( c.begin() ), end( c.end() ); 
+          j != end; ++j, ++i )
+      f( *j, i );
+  }
+
+private:
+  Extent const& e;
+  size_t n;
+  Function& f;
+};
+
+RINGING_END_DETAILS_NAMESPACE
+
+// Call f(r, i) for each row, r, of an extent or in-course half-extent,
+// where i is its position in it.  The rows are divided into chunks which
+// are processed concurrently using up to the given number of threads (see
+// run_parallel), so f must be safe to call concurrently.  Within a chunk,
+// rows are visited in order, without any allocation.
+template <class Extent, class Function>
+void parallel_for_each_row( Extent const& e, Function f, unsigned threads = 0 )
+{
+  if ( threads == 0 ) threads = default_thread_count();
+
+  // Use several chunks per thread to balance the load
+  size_t n = threads == 1 ? 1 : threads * 8;
+  if ( n > e.size() ) n = e.size();
+
+  RINGING_DETAILS_PREFIX extent_rows_task<Extent, Function> t( e, n, f );
+  run_parallel( t, n, threads );
+}
+
+
+// Generate the extent by plain changes (the Steinhaus-Johnson-Trotter
+// ordering), in which each row differs from the previous one by a swap
+// of one pair of adjacent working bells.  This uses Knuth's Algorithm P
+// (TAOCP, 7.2.1.2), which takes amortised constant time per row.  The
+// last row is also a single swap from rounds, so the extent can be rung
+// as a round block of nw! changes.  
+class RINGING_API plain_changes_iterator
+  : public RINGING_STD_CONST_ITERATOR( forward_iterator_tag, row )
+{
+public:
+  // Standard iterator typedefs
+  typedef forward_iterator_tag iterator_category;
+  typedef row value_type;
+  typedef ptrdiff_t difference_type;
+  typedef const row *pointer;
+  typedef const row &reference;
+
+  // A generic end iterator
+  plain_changes_iterator() : end_(true) {}
+
+  // The beginning iterator: the arguments are as for extent_iterator
+  plain_changes_iterator( unsigned int nw, unsigned int nh, unsigned int nt );
+  explicit plain_changes_iterator( unsigned int nw, unsigned int nh = 0u );
+
+  // Trivial Iterator implementation
+  const row *operator->() const { return &r; }
+  const row &operator*() const { return r; }
+  
+  // Equality Comparable implementation
+  bool operator==( const plain_changes_iterator &i ) const
+    { return end_ == i.end_ && (end_ || r == i.r); }
+  bool operator!=( const plain_changes_iterator &i ) const
+    { return !( *this == i ); }
+
+  // Forward Iterator implementation
+  plain_changes_iterator &operator++();
+  plain_changes_iterator operator++(int)
+    { plain_changes_iterator tmp(*this); ++*this; return tmp; }
+
+  bool is_end() const { return end_; }
+
+  // The change taking the current row to the next, or back to rounds
+  // from the last row.  Unless there are fewer than two working bells,
+  // this swaps the bells in positions swap_position() and one above it.
+  const change &next_change() const { return chs[p]; }
+  unsigned swap_position() const { return nh + p; }
+
+private:
+  void init( unsigned int nt );
+  void find_next();
+
+  unsigned nw, nh;
+  bool end_, last;
+  row r;
+  vector<change> chs;   // chs[i] swaps positions nh+i and nh+i+1 
+  size_t p;             // The index into chs of the next change
+  vector<int> c, o;     // Knuth's inversion counters and directions
+};
+
 
 class RINGING_API changes_iterator
   : public RINGING_STD_CONST_ITERATOR( forward_iterator_tag, change )
@@ -30,6 +30,7 @@
 #include <ringing/streamutils.h>
 #include <ringing/pointers.h>
 #include <ringing/group.h>
+#include <ringing/parallel.h>
 #if RINGING_OLD_INCLUDES
 #include <algo.h>
 #include <iterator.h>
@@ -63,9 +64,151 @@ static bool are_tenors_together( const row &r, int working_bells )
 }
 
 falseness_table::falseness_table()
-  : t(1, row())
+  : t(1, row()), flags(0)
 {}
 
+RINGING_START_ANON_NAMESPACE
+
+// Rows on up to sixteen bells are packed four bits to a bell, with the
+// first bell in the most significant position, so that packed rows 
+// compare in the same order as the rows themselves.
+typedef RINGING_ULLONG packed_row;
+size_t const max_packed_bells = 16;
+
+// Use threads if there are at least this many products to compute
+size_t const parallel_falseness_products = 65536;
+
+// The number of bells in the first n rows, if they all have the same
+// number and it is small enough to pack them, or zero otherwise.
+size_t packable_bells( vector<row> const& rows, size_t n )
+{
+  if ( n == 0 || size_t(rows[0].bells()) > max_packed_bells ) 
+    return 0;
+  for ( size_t i=1; i<n; ++i ) 
+    if ( rows[i].bells() != rows[0].bells() ) 
+      return 0;
+  return rows[0].bells();
+}
+
+// The first n rows, or their inverses, on b bells in a flat array.
+struct packed_lead
+{
+  packed_lead() : b(0) {}
+  packed_lead( vector<row> const& rows, size_t n, size_t b, bool invert );
+
+  size_t size() const { return signs.size(); }
+
+  size_t b;
+  vector<bell> bells;        // bells[i*b + j] is the jth bell of row i
+  vector<int> signs;
+  vector<bell> trebles;      // The position of the treble in the rows
+};
+
+packed_lead::packed_lead( vector<row> const& rows, size_t n, size_t b, 
+                          bool invert )
+  : b(b), bells( n*b ), signs( n ), trebles( n )
+{
+  for ( size_t i=0; i<n; ++i ) {
+    row const r( invert ? rows[i].inverse() : rows[i] );
+    for ( size_t j=0; j<b; ++j ) bells[i*b + j] = r[j];
+    signs[i] = r.sign();
+    trebles[i] = rows[i].find(0);
+  }
+}
+
+// Calculates the products a b^-1 for the rows a in part i of A, and
+// stores them, sorted and without duplicates, in results[i].
+class falseness_products
+{
+public:
+  falseness_products( packed_lead const& a, packed_lead const& binv, 
+                      size_t parts, int flags,
+                      vector< vector<packed_row> >& results )
+    : a(a), binv(binv), parts(parts), flags(flags), results(results)
+  {}
+
+  void operator()( size_t part ) const;
+
+private:
+  packed_lead const& a;
+  packed_lead const& binv;
+  size_t parts;
+  int flags;
+  vector< vector<packed_row> >& results;
+};
+
+void falseness_products::operator()( size_t part ) const
+{
+  size_t const n1 = a.size(), n2 = binv.size(), b = a.b;
+  vector<packed_row>& res = results[part];
+
+  for ( size_t i1 = part * n1 / parts, e1 = (part+1) * n1 / parts; 
+        i1 < e1; ++i1 )
+    for ( size_t i2 = 0; i2 < n2; ++i2 )
+    {
+      // a b^-1 fixes the treble iff a and b have it in the same place, 
+      // and its sign is the product of their signs.
+      if ( !( flags & falseness_table::no_fixed_treble )
+           && a.trebles[i1] != binv.trebles[i2] )
+        continue;
+
+      int const sign = a.signs[i1] * binv.signs[i2];
+      if ( ( flags & falseness_table::in_course_only ) && sign == -1 )
+        continue;
+      if ( ( flags & falseness_table::out_of_course_only ) && sign == +1 )
+        continue;
+
+      // (a b^-1)[j] == a[ b^-1[j] ]
+      bell const* const ar = &a.bells[ i1 * b ];
+      bell const* const br = &binv.bells[ i2 * b ];
+      packed_row f = 0;
+      for ( size_t j = 0; j < b; ++j )
+        f = f << 4 | packed_row( ar[ br[j] ] );
+      res.push_back(f);
+    }
+
+  sort( res.begin(), res.end() );
+  res.erase( unique( res.begin(), res.end() ), res.end() );
+}
+
+// The falseness table for two packed leads on the same number of bells.
+// If threads is 0, threads are only used if there is enough work.
+void packed_falseness( packed_lead const& a, packed_lead const& binv,
+                       int flags, unsigned threads, vector<row>& t )
+{
+  size_t const n1 = a.size(), n2 = binv.size(), b = a.b;
+  assert( binv.b == b );
+
+  if ( threads == 0 && n1 * n2 < parallel_falseness_products ) 
+    threads = 1;
+  if ( threads == 0 ) 
+    threads = default_thread_count();
+  size_t const parts = threads == 1 ? 1 : min( n1, size_t(threads) * 4 );
+
+  vector< vector<packed_row> > results( parts );
+  parallel_for( parts, falseness_products( a, binv, parts, flags, results ),
+                threads );
+
+  vector<packed_row> fs;
+  for ( size_t i=0; i<parts; ++i )
+    fs.insert( fs.end(), results[i].begin(), results[i].end() );
+  if ( parts > 1 ) {
+    sort( fs.begin(), fs.end() );
+    fs.erase( unique( fs.begin(), fs.end() ), fs.end() );
+  }
+
+  vector<bell> v( b );
+  t.reserve( fs.size() );
+  for ( vector<packed_row>::const_iterator i=fs.begin(), e=fs.end(); 
+        i != e; ++i ) {
+    for ( size_t j=0; j<b; ++j ) 
+      v[j] = int( *i >> 4*(b-1-j) & 0xF );
+    t.push_back( row(v) );
+  }
+}
+
+RINGING_END_ANON_NAMESPACE
+
 void falseness_table::init( vector<row> const& m1, vector<row> const& m2 )
 {
   // The inter-method falseness table is calculated using
@@ -73,11 +216,23 @@ void falseness_table::init( vector<row> const& m1, vector<row> const& m2 )
   // where A is the set of rows in the first lead of the first method,
   // similarly for B and the second method. 
 
+  size_t const 
+    n1( flags & half_lead_only ? m1.size() / 2 : m1.size() ),
+    n2( flags & half_lead_only ? m2.size() / 2 : m2.size() );
+
+  // Usually the rows can be packed into integers, which avoids allocating
+  // a row for each product, and allows the work to be split between 
+  // threads.  The results are identical to the general case, below.
+  size_t const b = packable_bells( m1, n1 );
+  if ( b && packable_bells( m2, n2 ) == b ) {
+    packed_falseness( packed_lead( m1, n1, b, false ), 
+                      packed_lead( m2, n2, b, true ), flags, 0, t );
+    return;
+  }
+
   set<row> fs;
 
-  vector<row>::const_iterator const
-    e1( flags & half_lead_only ?  m1.begin() + m1.size() / 2 : m1.end() ),
-    e2( flags & half_lead_only ?  m2.begin() + m2.size() / 2 : m2.end() );
+  vector<row>::const_iterator const e1( m1.begin() + n1 ), e2( m2.begin() + n2 );
 
   for ( vector<row>::const_iterator i1( m1.begin() ); i1 != e1; ++i1 )
     {
@@ -138,10 +293,106 @@ falseness_table::falseness_table( const vector<row> &a, const vector<row>& b,
   init( a, b );
 }
 
-group falseness_table::generate_group() const
+struct falseness_matrix::lead
+{
+  lead( vector<row> const& rows, int flags );
+
+  vector<row> rows;
+  packed_lead a, binv;   // Empty if the rows cannot be packed
+};
+
+falseness_matrix::lead::lead( vector<row> const& rows, int flags )
+  : rows(rows)
+{
+  size_t const n 
+    = flags & falseness_table::half_lead_only ? rows.size() / 2 : rows.size();
+  if ( size_t const b = packable_bells( rows, n ) ) {
+    a = packed_lead( rows, n, b, false );
+    binv = packed_lead( rows, n, b, true );
+  }
+}
+
+falseness_matrix::falseness_matrix( int flags, size_t tile_size )
+  : flags(flags), tile( tile_size ? tile_size : 1 )
+{}
+
+size_t falseness_matrix::push_back( const method& m )
+{
+  return push_back( row_block( m, row_block_flags(flags) ) );
+}
+
+size_t falseness_matrix::push_back( const vector<row>& rows )
+{
+  leads.push_back( shared_pointer<lead>( new lead( rows, flags ) ) );
+  return leads.size() - 1;
+}
+
+falseness_table falseness_matrix::table( size_t i, size_t j ) const
+{
+  return table( i, j, 0 );
+}
+
+falseness_table 
+falseness_matrix::table( size_t i, size_t j, unsigned threads ) const
+{
+  lead const& a = *leads[i];
+  lead const& b = *leads[j];
+
+  falseness_table ft;
+  ft.t.clear();
+  ft.flags = flags;
+  if ( a.a.b && a.a.b == b.binv.b )
+    packed_falseness( a.a, b.binv, flags, threads, ft.t );
+  else
+    ft.init( a.rows, b.rows );
+  return ft;
+}
+
+class falseness_matrix::tile_task : public parallel_task
+{
+public:
+  tile_task( falseness_matrix const& fm, pair_function& f, size_t last )
+    : fm(fm), f(f), last(last) {}
+
+  void add_tile( size_t i, size_t j ) { tiles.push_back( make_pair(i, j) ); }
+  size_t size() const { return tiles.size(); }
+
+  virtual void run( size_t n ) 
+  {
+    size_t const i0 = tiles[n].first, j0 = tiles[n].second;
+    for ( size_t i = i0; i < i0 + fm.tile && i < last; ++i )
+      for ( size_t j = j0; j < j0 + fm.tile && j < i; ++j )
+        if ( f.wanted(i, j) ) 
+          f( i, j, fm.table(i, j, 1) );
+  }
+
+private:
+  falseness_matrix const& fm;
+  pair_function& f;
+  size_t last;
+  vector< pair<size_t, size_t> > tiles;
+};
+
+void falseness_matrix::for_each_pair( size_t first, size_t last, 
+                                      pair_function& f, 
+                                      unsigned threads ) const
+{
+  if ( last > leads.size() ) last = leads.size();
+
+  tile_task t( *this, f, last );
+  for ( size_t i = first; i < last; i += tile ) {
+    size_t const imax = min( i + tile, last ) - 1;
+    for ( size_t j = 0; j < imax; j += tile )
+      t.add_tile( i, j );
+  }
+
+  run_parallel( t, t.size(), threads );
+}
+
+group falseness_table::generate_group( size_t order_bound ) const
 {
   if ( !( flags & out_of_course_only ) )
-    return group(t);
+    return group( t, order_bound );
 
   vector<row> t2; t2.reserve( t.size() * t.size() );
   for ( vector<row>::const_iterator i=t.begin(), e=t.end(); i!=e; ++i )
@@ -149,7 +400,7 @@ group falseness_table::generate_group() const
     t2.push_back( *i / *j );
     assert( t2.back().sign() == +1 );
   }
-  return group(t2);
+  return group( t2, order_bound );
 }
 
 false_courses::false_courses()
@@ -32,6 +32,7 @@
 #endif
 
 #include <ringing/row.h>
+#include <ringing/pointers.h>
 #if RINGING_OLD_INCLUDES
 #include <vector.h>
 #else
@@ -85,16 +86,75 @@ public:
   // Number of elements
   size_t size() const { return t.size(); }
 
-  // Use the falseness table as the generator set for a group
-  group generate_group() const;
+  // Use the falseness table as the generator set for a group.
+  // If order_bound is given, generation stops as soon as the group is 
+  // known to have at least that order.  See group's constructor.
+  group generate_group( size_t order_bound = 0 ) const;
 
 private:
+  friend class falseness_matrix;
+  friend class falseness_cache;
+  friend class falseness_graph;
   void init( vector<row> const& m1, vector<row> const& m2 );
 
   vector<row> t;
   int flags;
 };
 
+// The inter-method falseness tables between all pairs of a set of 
+// methods, such as a whole library.  The lead of each method is found and
+// prepared just once, when it is added, and the tables are calculated in
+// parallel in square tiles of pairs, so the memory needed does not 
+// depend on the number of methods.
+class RINGING_API falseness_matrix
+{
+public:
+  // The flags are as for falseness_table
+  explicit falseness_matrix( int flags = 0, size_t tile_size = 32 );
+
+  // Add a method, or the rows of its lead, returning its index
+  size_t push_back( const method& m );
+  size_t push_back( const vector<row>& lead );
+  size_t size() const { return leads.size(); }
+  size_t tile_size() const { return tile; }
+
+  // The falseness table between methods i and j.  This is the same as 
+  // falseness_table( a, b, flags ) where a and b are the two methods.
+  falseness_table table( size_t i, size_t j ) const;
+
+  // A function to be called for each pair of methods
+  class RINGING_API pair_function
+  {
+  public:
+    virtual ~pair_function() {}
+
+    // Is the falseness between methods i and j needed?  
+    virtual bool wanted( size_t i, size_t j ) const { return true; }
+
+    // This will be called concurrently from several threads.
+    virtual void operator()( size_t i, size_t j, 
+                             const falseness_table& ft ) = 0;
+  };
+
+  // Call f(i, j, table(i, j)) for each wanted pair with first <= i < last
+  // and j < i, using up to the given number of threads (see run_parallel).
+  // Within a tile, pairs are visited in order of i and then j, but 
+  // different tiles are processed concurrently.
+  void for_each_pair( size_t first, size_t last, pair_function& f,
+                      unsigned threads = 0 ) const;
+
+private:
+  struct lead;
+  class tile_task;
+  friend class tile_task;
+
+  falseness_table table( size_t i, size_t j, unsigned threads ) const;
+
+  int flags;
+  size_t tile;
+  vector< shared_pointer<lead> > leads;
+};
+
 // The set of course heads that are false against the plain course
 class RINGING_API false_courses
 {
@@ -134,6 +194,7 @@ public:
 private:
   class initialiser;
   friend class initialiser;
+  friend class falseness_cache;
 
   vector<row> t;
   int flags;
@@ -0,0 +1,311 @@
+// -*- C++ -*- falseness_cache.cpp - Persistent cache of falseness information
+// Copyright (C) 2014 Richard Smith <richard@ex-parrot.com>
+
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+// $Id$
+
+#include <ringing/common.h>
+
+#if RINGING_HAS_PRAGMA_INTERFACE
+#pragma implementation
+#endif
+
+#include <ringing/falseness_cache.h>
+#include <ringing/method.h>
+#include <ringing/lexical_cast.h>
+
+#if RINGING_OLD_INCLUDES
+#include <vector.h>
+#include <stdexcept.h>
+#include <fstream.h>
+#else
+#include <vector>
+#include <stdexcept>
+#include <fstream>
+#endif
+#if RINGING_OLD_C_INCLUDES
+#include <string.h>
+#else
+#include <cstring>
+#endif
+
+RINGING_START_NAMESPACE
+
+RINGING_USING_STD
+
+RINGING_START_ANON_NAMESPACE
+
+// The first line of a cache file
+char const* const cache_header = "# ringing-lib falseness cache 1";
+
+// Bells are always written with the default symbols so that the file
+// does not depend on $BELL_SYMBOLS.  Entries on more bells than there
+// are symbols are not cached.
+char const* const cache_symbols = "1234567890ETABCDFGHJKLMNPQRSUVWYZ";
+size_t const cache_max_bells = 33;
+
+bool cacheable( const method& m )
+{
+  return size_t( m.bells() ) <= cache_max_bells;
+}
+
+void append_changes( string& key, const method& m )
+{
+  key += ' ';
+  key += cache_symbols[ m.bells() - 1 ];
+  key += ' ';
+  for ( method::const_iterator i( m.begin() ), e( m.end() ); i != e; ++i ) {
+    if ( i != m.begin() ) key += '.';
+    size_t const n = key.size();
+    for ( int p = 0; p < m.bells(); ++p )
+      if ( i->findplace(p) )
+        key += cache_symbols[p];
+    if ( key.size() == n ) key += '-';
+  }
+}
+
+// The key is the kind of entry, the flags, and then the number of bells
+// and place notation of each method.
+string make_key( char kind, int flags, const method& m )
+{
+  string key( 1, kind );
+  key += ' ';
+  key += lexical_cast<string>(flags);
+  append_changes( key, m );
+  return key;
+}
+
+string make_key( char kind, int flags, const method& a, const method& b )
+{
+  string key( make_key( kind, flags, a ) );
+  append_changes( key, b );
+  return key;
+}
+
+template <class Container>
+string write_rows( const Container& c )
+{
+  string s;
+  for ( typename Container::const_iterator i( c.begin() ), e( c.end() );
+        i != e; ++i ) {
+    if ( i != c.begin() ) s += ' ';
+    for ( int j = 0; j < i->bells(); ++j )
+      s += cache_symbols[ (*i)[j] ];
+  }
+  return s;
+}
+
+// Returns false if the value is malformed
+bool read_rows( const string& s, vector<row>& rows )
+{
+  vector<bell> data;
+  for ( string::const_iterator i( s.begin() ), e( s.end() ); i != e; ) {
+    data.clear();
+    for ( ; i != e && *i != ' '; ++i ) {
+      char const* p = strchr( cache_symbols, *i );
+      if ( !*i || !p ) return false;
+      data.push_back( bell( p - cache_symbols ) );
+    }
+    if ( data.empty() ) return false;
+    rows.push_back( row(data) );
+    if ( i != e ) ++i;
+  }
+  return true;
+}
+
+RINGING_END_ANON_NAMESPACE
+
+falseness_cache::falseness_cache()
+{
+}
+
+falseness_cache::falseness_cache( const string& filename )
+{
+  {
+    ifstream in( filename.c_str() );
+    string line;
+    if ( in && getline( in, line ) && line != cache_header )
+      throw runtime_error( make_string() << "The file '" << filename
+                           << "' is not a falseness cache" );
+    while ( getline( in, line ) ) {
+      string::size_type const tab = line.find('\t');
+      if ( tab != string::npos )
+        entries[ line.substr(0, tab) ] = line.substr(tab+1);
+    }
+  }
+
+  bool const empty = entries.empty();
+  out.reset( new ofstream( filename.c_str(), ios::app ) );
+  if ( !*out )
+    throw runtime_error( make_string() << "Unable to open falseness cache '"
+                         << filename << "'" );
+  if ( empty && out->tellp() == streampos(0) )
+    *out << cache_header << '\n';
+}
+
+falseness_cache::~falseness_cache()
+{
+  if ( out ) out->flush();
+}
+
+bool falseness_cache::find( const string& key, string& value ) const
+{
+  mutex::scoped_lock l( m );
+  map<string, string>::const_iterator i( entries.find(key) );
+  if ( i == entries.end() ) return false;
+  value = i->second;
+  return true;
+}
+
+void falseness_cache::insert( const string& key, const string& value )
+{
+  mutex::scoped_lock l( m );
+  if ( entries.insert( make_pair( key, value ) ).second && out )
+    *out << key << '\t' << value << '\n';
+}
+
+size_t falseness_cache::size() const
+{
+  mutex::scoped_lock l( m );
+  return entries.size();
+}
+
+void falseness_cache::flush()
+{
+  mutex::scoped_lock l( m );
+  if ( out ) out->flush();
+}
+
+bool falseness_cache::lookup( const method& meth, int flags,
+                              false_courses& fc ) const
+{
+  string value;
+  vector<row> t;
+  if ( !cacheable(meth) || !find( make_key( 'C', flags, meth ), value )
+       || !read_rows( value, t ) )
+    return false;
+
+  fc.t.swap(t);
+  fc.flags = flags;
+  fc.lh = meth.lh();
+  return true;
+}
+
+bool falseness_cache::lookup( const method& meth, int flags,
+                              falseness_table& ft ) const
+{
+  string value;
+  vector<row> t;
+  if ( !cacheable(meth) || !find( make_key( 'T', flags, meth ), value )
+       || !read_rows( value, t ) )
+    return false;
+
+  ft.t.swap(t);
+  ft.flags = flags;
+  return true;
+}
+
+bool falseness_cache::lookup( const method& a, const method& b, int flags,
+                              falseness_table& ft ) const
+{
+  string value;
+  vector<row> t;
+  if ( !cacheable(a) || !cacheable(b)
+       || !find( make_key( 'P', flags, a, b ), value )
+       || !read_rows( value, t ) )
+    return false;
+
+  ft.t.swap(t);
+  ft.flags = flags;
+  return true;
+}
+
+bool falseness_cache::lookup_symbols( const method& meth, int flags,
+                                      string& syms ) const
+{
+  return cacheable(meth) && find( make_key( 'S', flags, meth ), syms );
+}
+
+void falseness_cache::store( const method& meth, int flags,
+                             const false_courses& fc )
+{
+  if ( cacheable(meth) )
+    insert( make_key( 'C', flags, meth ), write_rows(fc) );
+}
+
+void falseness_cache::store( const method& meth, int flags,
+                             const falseness_table& ft )
+{
+  if ( cacheable(meth) )
+    insert( make_key( 'T', flags, meth ), write_rows(ft) );
+}
+
+void falseness_cache::store( const method& a, const method& b, int flags,
+                             const falseness_table& ft )
+{
+  if ( cacheable(a) && cacheable(b) )
+    insert( make_key( 'P', flags, a, b ), write_rows(ft) );
+}
+
+void falseness_cache::store_symbols( const method& meth, int flags,
+                                     const string& syms )
+{
+  if ( cacheable(meth) )
+    insert( make_key( 'S', flags, meth ), syms );
+}
+
+false_courses falseness_cache::courses( const method& meth, int flags )
+{
+  false_courses fc;
+  if ( !lookup( meth, flags, fc ) ) {
+    fc = false_courses( meth, flags );
+    store( meth, flags, fc );
+  }
+  return fc;
+}
+
+falseness_table falseness_cache::table( const method& meth, int flags )
+{
+  falseness_table ft;
+  if ( !lookup( meth, flags, ft ) ) {
+    ft = falseness_table( meth, flags );
+    store( meth, flags, ft );
+  }
+  return ft;
+}
+
+falseness_table falseness_cache::table( const method& a, const method& b,
+                                        int flags )
+{
+  falseness_table ft;
+  if ( !lookup( a, b, flags, ft ) ) {
+    ft = falseness_table( a, b, flags );
+    store( a, b, flags, ft );
+  }
+  return ft;
+}
+
+string falseness_cache::symbols( const method& meth, int flags )
+{
+  string syms;
+  if ( !lookup_symbols( meth, flags, syms ) ) {
+    syms = courses( meth, flags ).symbols();
+    store_symbols( meth, flags, syms );
+  }
+  return syms;
+}
+
+RINGING_END_NAMESPACE
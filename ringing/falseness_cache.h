@@ -0,0 +1,120 @@
+// -*- C++ -*- falseness_cache.h - Persistent cache of falseness information
+// Copyright (C) 2014 Richard Smith <richard@ex-parrot.com>
+
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+// $Id$
+
+#ifndef RINGING_FALSENESS_CACHE_H
+#define RINGING_FALSENESS_CACHE_H
+
+#include <ringing/common.h>
+
+#if RINGING_HAS_PRAGMA_ONCE
+#pragma once
+#endif
+
+#if RINGING_HAS_PRAGMA_INTERFACE
+#pragma interface
+#endif
+
+#include <ringing/falseness.h>
+#include <ringing/parallel.h>
+#include <ringing/pointers.h>
+#if RINGING_OLD_INCLUDES
+#include <map.h>
+#include <string.h>
+#include <fstream.h>
+#else
+#include <map>
+#include <string>
+#include <fstream>
+#endif
+
+RINGING_START_NAMESPACE
+
+RINGING_USING_STD
+
+class method;
+
+// --------------------------------------------------------------
+//
+// A cache of the false course heads, falseness group symbols and
+// falseness tables of methods, optionally kept in a file so that it
+// persists between runs.  Entries are keyed by the method's place
+// notation (not its name) together with the flags used.
+//
+// The file is a plain text file with one entry per line.  It is read
+// once when the cache is opened, and new entries are appended to it as
+// they are stored.  Several programs can share a cache file, though
+// entries stored by one will not be seen by another that already has
+// it open.  All member functions may be called concurrently.
+//
+class RINGING_API falseness_cache
+{
+public:
+  // A cache held only in memory
+  falseness_cache();
+
+  // A cache kept in the named file, which is created if it does not
+  // exist.  Throws runtime_error if the file cannot be opened.
+  explicit falseness_cache( const string& filename );
+
+ ~falseness_cache();
+
+  // Look up an entry, returning false if it is not in the cache.  The
+  // flags are as for the constructors of false_courses and
+  // falseness_table respectively.
+  bool lookup( const method& m, int flags, false_courses& fc ) const;
+  bool lookup( const method& m, int flags, falseness_table& ft ) const;
+  bool lookup( const method& a, const method& b, int flags,
+               falseness_table& ft ) const;
+  bool lookup_symbols( const method& m, int flags, string& syms ) const;
+
+  // Add an entry to the cache.
+  void store( const method& m, int flags, const false_courses& fc );
+  void store( const method& m, int flags, const falseness_table& ft );
+  void store( const method& a, const method& b, int flags,
+              const falseness_table& ft );
+  void store_symbols( const method& m, int flags, const string& syms );
+
+  // Look up an entry, and if it is not present, calculate and store it.
+  false_courses courses( const method& m, int flags = 0 );
+  falseness_table table( const method& m, int flags = 0 );
+  falseness_table table( const method& a, const method& b, int flags = 0 );
+  string symbols( const method& m, int flags );
+
+  // The number of entries in the cache
+  size_t size() const;
+
+  // Write any new entries to the file
+  void flush();
+
+private:
+  // Unimplemented to prevent copying
+  falseness_cache( falseness_cache const& );
+  falseness_cache& operator=( falseness_cache const& );
+
+  bool find( const string& key, string& value ) const;
+  void insert( const string& key, const string& value );
+
+  mutable mutex m;  // Protects the following
+  map<string, string> entries;
+  scoped_pointer<ofstream> out;
+};
+
+RINGING_END_NAMESPACE
+
+#endif // RINGING_FALSENESS_CACHE_H
@@ -0,0 +1,258 @@
+// -*- C++ -*- falseness_graph.cpp - Analysis of the graph of false leads
+// Copyright (C) 2014 Richard Smith <richard@ex-parrot.com>
+
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+// $Id$
+
+#include <ringing/common.h>
+
+#if RINGING_HAS_PRAGMA_INTERFACE
+#pragma implementation
+#endif
+
+#include <ringing/falseness_graph.h>
+#include <ringing/falseness.h>
+#include <ringing/extent.h>
+
+#if RINGING_OLD_INCLUDES
+#include <map.h>
+#include <queue.h>
+#include <algo.h>
+#include <utility.h>
+#else
+#include <map>
+#include <queue>
+#include <algorithm>
+#include <utility>
+#endif
+#if RINGING_OLD_C_INCLUDES
+#include <assert.h>
+#else
+#include <cassert>
+#endif
+
+RINGING_START_NAMESPACE
+
+RINGING_USING_STD
+
+RINGING_START_ANON_NAMESPACE
+
+// The largest number of lead heads for which the colouring is kept in
+// bitsets.  At this size they need 32MB between them.
+size_t const max_dense_size = size_t(1) << 27;
+
+// The colouring of the lead heads when there are few enough of them to
+// index by position in the extent.
+class dense_colouring
+{
+public:
+  dense_colouring( size_t n, int b, int h )
+    : seen(n), colour(n), nw(b-h), nh(h) {}
+
+  // If r has already been coloured, return its colour; otherwise
+  // colour it c and return -1.
+  int visit( row const& r, bool c )
+  {
+    size_t const i = position_in_extent( r, nw, nh );
+    if ( seen[i] ) return colour[i];
+    seen[i] = true; colour[i] = c;
+    return -1;
+  }
+
+private:
+  vector<bool> seen, colour;
+  unsigned nw, nh;
+};
+
+class sparse_colouring
+{
+public:
+  int visit( row const& r, bool c )
+  {
+    pair< map<row, bool>::iterator, bool > const i
+      = colour.insert( make_pair(r, c) );
+    return i.second ? -1 : i.first->second;
+  }
+
+private:
+  map<row, bool> colour;
+};
+
+RINGING_END_ANON_NAMESPACE
+
+falseness_graph::falseness_graph( const falseness_table& ft )
+  : b(0), h(0), n(0)
+{
+  for ( falseness_table::const_iterator i( ft.begin() ), e( ft.end() );
+        i != e; ++i ) {
+    if ( i->bells() > b ) b = i->bells();
+    if ( !i->isrounds() ) gens.push_back(*i);
+  }
+
+  for ( vector<row>::iterator i( gens.begin() ), e( gens.end() );
+        i != e; ++i )
+    i->resize(b);
+
+  h = ft.flags & falseness_table::no_fixed_treble ? 0 : 1;
+  if ( h > b ) h = b;
+
+  n = 1;
+  for ( int i = 2; n && i <= b-h; ++i )
+    n = n > size_t(-1) / i ? 0 : n * i;
+}
+
+template <class Colouring>
+bool falseness_graph::search( Colouring& c, bool bipartite_only,
+                              size_t& count ) const
+{
+  bool bipartite = true;
+
+  queue< pair<row, bool> > q;
+  q.push( make_pair( row(b), false ) );
+  c.visit( q.front().first, false );
+  count = 1;
+
+  while ( !q.empty() ) {
+    row const r( q.front().first );
+    bool const colour( q.front().second );
+    q.pop();
+
+    for ( vector<row>::const_iterator i( gens.begin() ), e( gens.end() );
+          i != e; ++i ) {
+      row s( r * *i );
+      int const old = c.visit( s, !colour );
+      if ( old == -1 ) {
+        ++count;
+        q.push( make_pair( s, !colour ) );
+      }
+      else if ( bool(old) == colour ) {
+        bipartite = false;
+        if ( bipartite_only ) return false;
+      }
+    }
+  }
+
+  return bipartite;
+}
+
+bool falseness_graph::search( bool bipartite_only, size_t& count ) const
+{
+  if ( n && n <= max_dense_size ) {
+    dense_colouring c( n, b, h );
+    return search( c, bipartite_only, count );
+  } else {
+    sparse_colouring c;
+    return search( c, bipartite_only, count );
+  }
+}
+
+bool falseness_graph::is_bipartite() const
+{
+  size_t count;
+  return search( true, count );
+}
+
+size_t falseness_graph::component_size() const
+{
+  size_t count;
+  search( false, count );
+  return count;
+}
+
+size_t falseness_graph::components() const
+{
+  return n ? n / component_size() : 0;
+}
+
+
+size_t const splice_clusters::npos;
+
+void splice_clusters::add( size_t i )
+{
+  if ( i >= parent.size() ) {
+    parent.resize( i+1, npos );
+    members.resize( i+1 );
+    first.resize( i+1 );
+  }
+
+  if ( parent[i] == npos ) {
+    parent[i] = i;
+    members[i].push_back(i);
+    first[i] = joins;
+  }
+}
+
+size_t splice_clusters::find( size_t i ) const
+{
+  assert( contains(i) );
+
+  size_t r = i;
+  while ( parent[r] != r ) r = parent[r];
+
+  // Path compression
+  while ( parent[i] != r ) {
+    size_t const next = parent[i];
+    parent[i] = r;
+    i = next;
+  }
+
+  return r;
+}
+
+void splice_clusters::join( size_t i, size_t j )
+{
+  add(i); add(j);
+  size_t ri = find(i), rj = find(j);
+  ++joins;
+  if ( ri == rj ) return;
+
+  // Merge the smaller cluster into the larger
+  if ( members[ri].size() < members[rj].size() )
+    RINGING_PREFIX_STD swap( ri, rj );
+
+  parent[rj] = ri;
+  members[ri].insert( members[ri].end(),
+                      members[rj].begin(), members[rj].end() );
+  vector<size_t>().swap( members[rj] );
+  first[ri] = min( first[ri], first[rj] );
+}
+
+vector<size_t> splice_clusters::cluster( size_t i ) const
+{
+  vector<size_t> c( members[ find(i) ] );
+  sort( c.begin(), c.end() );
+  return c;
+}
+
+vector< vector<size_t> > splice_clusters::clusters() const
+{
+  // Order the representatives by the earliest edge in their clusters
+  vector< pair<size_t, size_t> > roots;
+  for ( size_t i = 0; i < parent.size(); ++i )
+    if ( parent[i] == i )
+      roots.push_back( make_pair( first[i], i ) );
+  sort( roots.begin(), roots.end() );
+
+  vector< vector<size_t> > c;
+  c.reserve( roots.size() );
+  for ( size_t i = 0; i < roots.size(); ++i ) {
+    c.push_back( members[ roots[i].second ] );
+    sort( c.back().begin(), c.back().end() );
+  }
+  return c;
+}
+
+RINGING_END_NAMESPACE
@@ -0,0 +1,145 @@
+// -*- C++ -*- falseness_graph.h - Analysis of the graph of false leads
+// Copyright (C) 2014 Richard Smith <richard@ex-parrot.com>
+
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+// $Id$
+
+#ifndef RINGING_FALSENESS_GRAPH_H
+#define RINGING_FALSENESS_GRAPH_H
+
+#include <ringing/common.h>
+
+#if RINGING_HAS_PRAGMA_ONCE
+#pragma once
+#endif
+
+#if RINGING_HAS_PRAGMA_INTERFACE
+#pragma interface
+#endif
+
+#include <ringing/row.h>
+#if RINGING_OLD_INCLUDES
+#include <vector.h>
+#else
+#include <vector>
+#endif
+
+RINGING_START_NAMESPACE
+
+RINGING_USING_STD
+
+class falseness_table;
+
+// --------------------------------------------------------------
+//
+// The falseness graph of a falseness table.  The vertices are lead
+// heads, and each lead head h is joined to h f for every f in the table
+// other than rounds.  The lead heads are the rows which fix the treble,
+// unless the table was made with falseness_table::no_fixed_treble.
+//
+// The component containing h is the coset h G, where G is the group
+// generated by the table, so every component is isomorphic to the one
+// containing rounds, and only that one is ever searched.  The search is
+// a breadth-first search which, when there are few enough lead heads,
+// records the colouring in a pair of bitsets indexed by each lead head's
+// position in the extent.
+//
+// An extent using a single type of call that affects just the lead-end
+// change is only possible if the falseness graph of the plain lead is
+// bipartite.
+//
+class RINGING_API falseness_graph
+{
+public:
+  explicit falseness_graph( const falseness_table& ft );
+
+  int bells() const { return b; }
+
+  // The number of leading bells fixed by every lead head: 0 or 1
+  int hunts() const { return h; }
+
+  // The number of lead heads: (bells() - hunts())!, or 0 if that
+  // overflows.
+  size_t size() const { return n; }
+
+  // Can the lead heads be coloured with two colours so that no two
+  // false lead heads have the same colour?  This returns as soon as it
+  // finds an odd cycle.
+  bool is_bipartite() const;
+
+  // The number of lead heads in each component.  This is the order of
+  // the group generated by the falseness table.
+  size_t component_size() const;
+
+  // The number of components, or 0 if size() overflows
+  size_t components() const;
+
+private:
+  template <class Colouring> bool search( Colouring& c, bool bipartite_only,
+                                          size_t& count ) const;
+  bool search( bool bipartite_only, size_t& count ) const;
+
+  int b, h;
+  size_t n;
+  vector<row> gens;   // The non-trivial elements of the table
+};
+
+// --------------------------------------------------------------
+//
+// Clusters of methods, or of anything else, joined by splices.  The
+// vertices are numbered 0, 1, 2, ... and edges are added one at a time;
+// the clusters are the connected components of the resulting graph.
+// This uses a disjoint-set forest with union by size, so adding an
+// edge and finding a vertex's cluster take close to constant time.
+//
+class RINGING_API splice_clusters
+{
+public:
+  splice_clusters() : joins(0) {}
+
+  // Add an edge between vertices i and j, adding the vertices if
+  // necessary.
+  void join( size_t i, size_t j );
+
+  // Has vertex i been joined to anything (even itself)?
+  bool contains( size_t i ) const
+    { return i < parent.size() && parent[i] != npos; }
+
+  // A representative of the cluster containing i, which must be
+  // present.  Two vertices are in the same cluster if and only if
+  // they have the same representative.
+  size_t find( size_t i ) const;
+
+  // The vertices in the cluster containing i, in increasing order
+  vector<size_t> cluster( size_t i ) const;
+
+  // All of the clusters, ordered by the earliest edge in each
+  vector< vector<size_t> > clusters() const;
+
+private:
+  void add( size_t i );
+
+  static size_t const npos = size_t(-1);
+
+  size_t joins;
+  mutable vector<size_t> parent;      // npos if absent
+  vector< vector<size_t> > members;   // Only valid for representatives
+  vector<size_t> first;               // Ditto: the index of earliest edge
+};
+
+RINGING_END_NAMESPACE
+
+#endif // RINGING_FALSENESS_GRAPH_H
@@ -24,20 +24,27 @@
 #endif
 
 #include <ringing/row.h>
+#include <ringing/change.h>
 #include <ringing/group.h>
-#include <ringing/extent.h>
+#include <ringing/stabilizer_chain.h>
+#include <ringing/parallel.h>
 #include <ringing/mathutils.h>
 
 #if RINGING_OLD_INCLUDES
-#include <set.h>
 #include <vector.h>
 #include <algo.h>
 #include <limits.h>
+#include <stdexcept.h>
 #else
-#include <set>
 #include <vector>
 #include <algorithm>
 #include <limits>
+#include <stdexcept>
+#endif
+#if RINGING_OLD_C_INCLUDES
+#include <assert.h>
+#else
+#include <cassert>
 #endif
 
 RINGING_START_NAMESPACE
@@ -46,26 +53,30 @@ RINGING_USING_STD
 
 RINGING_START_ANON_NAMESPACE
 
-// This algorithm is non-recursive because some groups are big
-// enough that they cause a stack overflow when calculating them.
-void generate_group( set<row>& s, const row& r0, 
-                     const vector<row>& generators )
-{
-  vector<row> x( 1u, r0 );
+// Groups up to this order are enumerated when they are constructed.
+size_t const small_group_order = 1024;
 
-  while (x.size()) {
-    row r = x.back(); x.pop_back();
+// Groups of at least this order are enumerated using several threads.
+size_t const parallel_group_order = 65536;
 
-    for ( vector<row>::const_iterator 
-	    i( generators.begin() ), e( generators.end() );
-	  i != e;  ++i )
-    {
-      const row r2( r * *i );
-      if ( s.insert( r2 ).second )
-        x.push_back(r2);
-    }
+class enumerate_branch
+{
+public:
+  enumerate_branch( stabilizer_chain const& c, vector<row>& v ) 
+    : c(c), v(v), len( v.size() / c.branches() ) {}
+
+  void operator()( size_t i ) const {
+    vector<row>::iterator out( v.begin() + i * len );
+    for ( stabilizer_chain::const_iterator j( c.begin_branch(i) ), 
+            e( c.end() );  j != e;  ++j, ++out ) 
+      *out = *j;
   }
-}
+
+private:
+  stabilizer_chain const& c;
+  vector<row>& v;
+  size_t len;
+};
 
 bool is_direct_product_of_symmetric_groups( vector< vector<bell> > const& o,
                                             size_t gsize )
@@ -93,118 +104,253 @@ bool is_direct_product_of_symmetric_groups( vector< vector<bell> > const& o,
   return sz == gsize;
 }
 
+// The points 0, 1, ..., b-1 as a base gives lexicographical enumeration
+vector<bell> natural_base( size_t b )
+{
+  vector<bell> base( b );
+  for ( size_t i=0; i<b; ++i ) base[i] = i;
+  return base;
+}
+
 RINGING_END_ANON_NAMESPACE
 
+// A node in the tree used to find the minimal images of right cosets.
+// Each node represents a subgroup, H, of the original group, being the
+// pointwise stabilizer of the minimal images chosen so far.
+struct group::image_node
+{
+  image_node( size_t b, vector<row> const& gens, 
+              shared_pointer<mutex> const& m );
+
+  // The node for the stabilizer of p in H.  p must be the least point 
+  // in its orbit.
+  image_node* child( bell p );
+
+  shared_pointer<mutex> m;  // Shared by the whole tree; guards children
+  size_t b;
+  vector<row> gens;
+  vector<bell> least;     // The least point in the orbit of each point
+  vector<row> to_least;   // An element of H taking each point there, or
+                          // an empty row if it is already the least
+  vector<bool> fixed;     // Whether each point is fixed by H
+  vector< shared_pointer< image_node > > children;
+};
+
+group::image_node::image_node( size_t b, vector<row> const& gens,
+                               shared_pointer<mutex> const& m )
+  : m(m), b(b), gens(gens), least( b, bell(b) ), to_least(b), fixed(b), 
+    children(b)
+{
+  vector<row> inv; inv.reserve( gens.size() );
+  for ( vector<row>::const_iterator i=gens.begin(), e=gens.end(); i!=e; ++i )
+    inv.push_back( i->inverse() );
+
+  // Taking the points in order, each unseen point is the least in its 
+  // orbit, so a breadth first search from it finds the rest of the orbit.
+  vector<bell> queue;  queue.reserve(b);
+  for ( size_t x=0; x<b; ++x ) if ( size_t(least[x]) == b ) 
+  {
+    least[x] = x;
+    queue.clear();  queue.push_back(x);
+    for ( size_t qi=0; qi<queue.size(); ++qi ) 
+    {
+      bell const y = queue[qi];
+      for ( size_t gi=0; gi<gens.size(); ++gi ) 
+      {
+        bell const z = gens[gi][y];
+        if ( size_t(least[z]) != b ) continue;
+        least[z] = x;
+        to_least[z] = to_least[y].bells() ? to_least[y] * inv[gi] : inv[gi];
+        queue.push_back(z);
+      }
+    }
+    fixed[x] = queue.size() == 1;
+  }
+}
+
+group::image_node* group::image_node::child( bell p )
+{
+  // If m is fixed by H, its stabilizer is H itself
+  if ( fixed[p] ) return this;
+
+  mutex::scoped_lock l( *m );
+  if ( !children[p] ) {
+    stabilizer_chain const c( gens, vector<bell>( 1u, p ) );
+    children[p].reset( new image_node( b, c.stabilizer_generators(1), m ) );
+  }
+  return children[p].get();
+}
+
+void group::init( const vector<row>& gens, size_t order_bound )
+{
+  b = 0;
+  for ( vector<row>::const_iterator i( gens.begin() ), e( gens.end() );  
+        i != e;  ++i )
+    if ( size_t(i->bells()) > b ) 
+      b = i->bells();
+
+  chain.reset( new stabilizer_chain( gens, natural_base(b), order_bound ) );
+
+  RINGING_ULLONG const o = chain->order();
+  if ( o > numeric_limits<size_t>::max() )
+    throw overflow_error( "Group order is too large to represent" );
+  n = o;
+
+  v.clear();
+  images.reset();
+  if ( chain->complete() ) {
+    if ( n <= small_group_order ) 
+      enumerate();
+    images.reset( new image_node( b, chain->generators(), 
+                                  shared_pointer<mutex>( new mutex ) ) );
+  }
+
+  calc_orbit_space();
+}
+
+void group::enumerate() const
+{
+  if ( !v.empty() ) 
+    return;
+
+  if ( n < parallel_group_order ) {
+    v.reserve( n );
+    copy( chain->begin(), chain->end(), back_inserter(v) );
+  }
+  else {
+    // Each branch of the chain fills a separate, contiguous part of v
+    v.resize( n );
+    parallel_for( chain->branches(), enumerate_branch( *chain, v ) );
+  }
+}
+
+group::group()
+  : b(0), n(1), chain( new stabilizer_chain ), v(1u)
+{}
+
 group group::symmetric_group(int nw, int nh, int nt)
 {
   if (!nt) nt = nh + nw;
+
+  // Generated by a transposition and a cycle of the working bells
+  vector<row> gens;
+  row r(nt);
+  if ( nw > 1 ) { 
+    change c(nt); c.swappair(nh); 
+    gens.push_back( r * c ); 
+  }
+  if ( nw > 2 ) {
+    vector<bell> cyc( nt );
+    for ( int i=0; i<nt; ++i ) 
+      cyc[i] = i < nh || i >= nh+nw ? i : i+1 == nh+nw ? nh : i+1;
+    gens.push_back( row(cyc) );
+  }
+  gens.push_back(r);
+
   group g; 
-  g.b = nt;
-  g.v.clear();
-  g.v.reserve( factorial(nw) );
-  copy( extent_iterator(nw, nh, nt), extent_iterator(), 
-	back_inserter(g.v) );
-  g.calc_orbit_space();
+  g.init( gens );
   return g;
 }
 
 group group::alternating_group(int nw, int nh, int nt)
 {
   if (!nt) nt = nh + nw;
+
+  // Generated by the 3-cycles (a, a+1, a+2) of the working bells
+  vector<row> gens;
+  for ( int i=nh; i+2 < nh+nw; ++i ) {
+    vector<bell> cyc( nt );
+    for ( int j=0; j<nt; ++j ) cyc[j] = j;
+    cyc[i] = i+1; cyc[i+1] = i+2; cyc[i+2] = i;
+    gens.push_back( row(cyc) );
+  }
+  gens.push_back( row(nt) );
+
   group g; 
-  g.b = nt;
-  g.v.clear();
-  g.v.reserve( factorial(nw) / 2 );
-  copy( incourse_extent_iterator(nw, nh, nt), incourse_extent_iterator(), 
-	back_inserter(g.v) );
-  g.calc_orbit_space();
+  g.init( gens );
   return g;
 }
 
 group::group( const row& gen )
-  : b( gen.bells() )
 {
-  set< row > s;
-  generate_group( s, row(gen.bells()), vector<row>(1u, gen) );
-  v.reserve(s.size());
-  copy( s.begin(), s.end(), back_inserter(v) );
-  calc_orbit_space();
+  init( vector<row>(1u, gen) );
 }
 
 group::group( const row& g1, const row& g2 )
-  : b( g1.bells() > g2.bells() ? g1.bells() : g2.bells() )
 {
   vector<row> gens; gens.reserve(2); 
-  gens.push_back(g1); 
-  if (g2 != g1) gens.push_back(g2);
-
-  set< row > s;
-
-  size_t b( g1.bells() > g2.bells() ? g1.bells() : g2.bells() );
-  generate_group( s, row(b), gens );
-  v.reserve(s.size());
-  copy( s.begin(), s.end(), back_inserter(v) );
-  calc_orbit_space();
+  gens.push_back(g1); gens.push_back(g2);
+  init( gens );
 }
 
 group::group( const vector<row>& gens )
-  : b(0)
 {
-  if (gens.empty()) { v.push_back( row() ); return; }
-
-  set< row > s;
-
-  vector<row> uniq_gens(gens);
-  sort( uniq_gens.begin(), uniq_gens.end() );
-  uniq_gens.erase( unique( uniq_gens.begin(), uniq_gens.end() ), 
-		   uniq_gens.end() );
+  if (gens.empty()) { group().swap(*this); return; }
+  init( gens );
+}
 
-  // Find the maximum number of bells in any of the gens
-  for ( vector<row>::const_iterator 
-	  i( uniq_gens.begin() ), e( uniq_gens.end() );  i != e;  ++i )
-    if ( size_t(i->bells()) > b ) 
-      b = i->bells();
+group::group( const vector<row>& gens, size_t order_bound )
+{
+  if (gens.empty()) { group().swap(*this); return; }
+  init( gens, order_bound );
+}
 
-  generate_group( s, row(b), uniq_gens );
-  v.reserve(s.size());
-  copy( s.begin(), s.end(), back_inserter(v) );
-  calc_orbit_space();
+void group::swap( group& g )
+{
+  RINGING_PREFIX_STD swap( b, g.b );
+  RINGING_PREFIX_STD swap( n, g.n );
+  chain.swap( g.chain );
+  v.swap( g.v );
+  images.swap( g.images );
+  o.swap( g.o );
 }
 
 group group::conjugate( const row& r ) const
 {
-  group g;
-
-  g.b = b;
-  g.v.clear();  // Default constructor populates it with a single element
-  g.v.reserve( v.size() );
-
   const row ri( r.inverse() );
 
-  for ( vector<row>::const_iterator i( v.begin() ), e( v.end() );
-	i != e;  ++i )
-    g.v.push_back( ri * *i * r );
+  vector<row> gens;
+  gens.reserve( generators().size() + 1 );
+  for ( vector<row>::const_iterator i( generators().begin() ), 
+          e( generators().end() );  i != e;  ++i )
+    gens.push_back( ri * *i * r );
 
-  // Keep it sorted so that comparison is cheap(ish)
-  sort( g.v.begin(), g.v.end() );
-  g.calc_orbit_space();
+  // Preserve the number of bells even if all generators were trivial
+  gens.push_back( row(b) );
 
+  group g;
+  g.init( gens );
   return g;
 }
 
 bool operator==( const group& a, const group& b )
 {
-  return a.b == b.b && a.v == b.v;
+  // Two groups of the same order are equal if either contains all 
+  // the generators of the other.
+  if ( a.b != b.b || a.n != b.n ) 
+    return false;
+
+  for ( vector<row>::const_iterator i( a.generators().begin() ),
+          e( a.generators().end() );  i != e;  ++i )
+    if ( !b.contains(*i) )
+      return false;
+
+  return true;
 }
 
+// Groups are ordered by lexicographical comparison of their (sorted) 
+// elements.  This is done using the stabilizer chains' lazy enumeration
+// so that large groups need not be enumerated. 
 bool operator<( const group& a, const group& b )
 {
-  return a.b < b.b || a.b == b.b && a.v < b.v;
+  if ( a.b != b.b ) return a.b < b.b;
+  return lexicographical_compare( a.chain->begin(), a.chain->end(),
+                                  b.chain->begin(), b.chain->end() );
 }
 
 bool operator>( const group& a, const group& b )
 {
-  return a.b > b.b || a.b == b.b && a.v > b.v;
+  return b < a;
 }
 
 row group::rcoset_label( row const& r ) const
@@ -234,40 +380,97 @@ row group::rcoset_label( row const& r ) const
     return row(label);
   }
 
-  // Default to an O(|G|) algorithm
-  row label;
-  for ( const_iterator i=v.begin(), e=v.end(); i != e; ++i ) 
+  // Otherwise find the minimal image one position at a time.  If the 
+  // least value (g*r)[i] can take (given the earlier positions) is m,
+  // the remaining choices of g are h*t where t is a fixed element
+  // achieving it, and h is in the stabilizer of m.  These stabilizers
+  // are found as they are needed and cached in a tree.
+  assert( images );
+
+  size_t const nb = max( b, size_t(r.bells()) );
+  vector<bell> label( nb );
+  for ( size_t i=0; i<nb; ++i )
+    label[i] = i < size_t(r.bells()) ? r[i] : bell(i);
+
+  image_node* node = images.get();
+  for ( size_t i=0; i<nb && node->gens.size(); ++i ) 
   {
-    row const ir = *i * r;
-    if (label.bells() == 0 || ir < label) 
-      label = ir;
+    bell const x = label[i];
+    if ( size_t(x) >= b ) continue;
+
+    row const& t = node->to_least[x];
+    if ( t.bells() ) 
+      for ( size_t j=0; j<nb; ++j )
+        if ( size_t(label[j]) < b )
+          label[j] = t[ label[j] ];
+
+    node = node->child( node->least[x] );
   }
-  return label;
+
+  return row(label);
 }
 
 row group::lcoset_label( row const& r ) const
 {
-  row label;
-  for ( const_iterator i=v.begin(), e=v.end(); i != e; ++i ) 
+  if ( size() == 1 ) return r;
+
+  // The stabilizer chain has base 0, 1, ..., b-1, and every element is
+  // uniquely u_0 * u_1 * ... * u_{b-1} where u_i is a transversal element 
+  // at level i.  As u_i fixes 0, ..., i-1, position i of r*g is determined
+  // by u_0, ..., u_i alone, and so the u_i can be chosen greedily.
+  size_t const nb = max( b, size_t(r.bells()) );
+  vector<bell> label( nb ), tmp( nb );
+  for ( size_t i=0; i<nb; ++i )
+    label[i] = i < size_t(r.bells()) ? r[i] : bell(i);
+
+  for ( size_t i=0; i<chain->depth(); ++i )
   {
-    row const ir = r * *i;
-    if (label.bells() == 0 || ir < label) 
-      label = ir;
+    vector<bell> const& orb = chain->orbit(i);
+    if ( orb.size() == 1 ) continue;
+
+    bell y = orb[0];
+    for ( vector<bell>::const_iterator j=orb.begin(), e=orb.end(); j!=e; ++j )
+      if ( label[*j] < label[y] )
+        y = *j;
+
+    if ( y != chain->base_point(i) ) {
+      row const& t = chain->transversal(i, y);
+      for ( size_t j=0; j<nb; ++j ) 
+        tmp[j] = j < b ? label[ t[j] ] : label[j];
+      label.swap(tmp);
+    }
   }
-  return label;
+
+  return row(label);
 }
 
 void group::calc_orbit_space() const
 {
-  vector< set<bell> > orbs( bells() );
+  // The orbits are the connected components of the graph with an 
+  // edge from j to g[j] for each generator g.
+  vector<size_t> comp( bells() );
+  for ( size_t j=0; j<bells(); ++j ) comp[j] = j;
+
+  bool changed;
+  do {
+    changed = false;
+    for ( vector<row>::const_iterator i( generators().begin() ),
+            e( generators().end() );  i != e;  ++i ) 
+      for ( size_t j=0; j<bells(); ++j ) {
+        size_t const k = (*i)[j];
+        if ( comp[j] != comp[k] ) {
+          comp[j] = comp[k] = min( comp[j], comp[k] );
+          changed = true;
+        }
+      }
+  } while (changed);
 
-  for ( const_iterator i=v.begin(), e=v.end(); i != e; ++i ) 
-    for ( size_t j=0; j<bells(); ++j )
-      orbs[j].insert( (*i)[j] );
- 
   o.clear(); 
   for ( size_t j=0; j<bells(); ++j ) {
-    vector<bell> oj( orbs[j].begin(), orbs[j].end() );
+    vector<bell> oj;
+    for ( size_t k=0; k<bells(); ++k )
+      if ( comp[k] == comp[j] )
+        oj.push_back(k);
     if ( find( o.begin(), o.end(), oj ) == o.end() )
       o.push_back(oj);
   }
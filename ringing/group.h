@@ -31,6 +31,8 @@
 #endif
 
 #include <ringing/row.h>
+#include <ringing/stabilizer_chain.h>
+#include <ringing/pointers.h>
 #if RINGING_OLD_INCLUDES
 #include <vector.h>
 #else
@@ -45,23 +47,49 @@ RINGING_USING_STD
 //
 // Geneates a group from a set of generators 
 //
+// The group is held as a stabilizer chain, so its order, membership 
+// and comparisons do not require its elements to be enumerated.  Small
+// groups are also stored as a sorted vector of elements; larger ones are
+// only enumerated when begin() is first called.  This is done lazily
+// (though using several threads for very large groups), so a large group 
+// must have begin() called before it is shared between threads.
+//
 class RINGING_API group
 {
 public:
-  group() : b(0), v(1u) {} // The group containing just the identity
+  group(); // The group containing just the identity
   explicit group( const row& generator );
   explicit group( const row& generator1, const row& generator2 );
   explicit group( const vector<row> &generators );
 
+  // If the order of the group is at least order_bound, stop generating
+  // it as soon as this is known.  In that case, complete() returns false,
+  // size() returns a lower bound on the order (at least order_bound), and 
+  // the group should not otherwise be used.  This is useful when only 
+  // groups smaller than some known maximum are of interest.
+  group( const vector<row> &generators, size_t order_bound );
+
   size_t bells() const { return b; }
+  bool complete() const { return chain->complete(); }
 
-  // Container interface
+  // Container interface.  Elements are in lexicographical order.
   typedef vector<row>::const_iterator const_iterator;
-  const_iterator begin() const { return v.begin(); }
-  const_iterator end()   const { return v.end();   }
-  size_t         size()  const { return v.size();  }
+  const_iterator begin() const { enumerate(); return v.begin(); }
+  const_iterator end()   const { enumerate(); return v.end();   }
+  size_t         size()  const { return n; }
+
+  void swap( group& g );
 
-  void swap( group& g ) { v.swap(g.v); }
+  // Is r an element of the group?  This is O(n^2) in the number of bells.
+  bool contains( const row& r ) const { return chain->contains(r); }
+
+  // A uniformly distributed random element of the group
+  row random_element() const { return chain->random_element(); }
+
+  // The generators the group was constructed from, and its 
+  // stabilizer chain.
+  const vector<row>& generators() const { return chain->generators(); }
+  const stabilizer_chain& get_chain() const { return *chain; }
 
   // Named constructors
   static group symmetric_group(int nw, int nh = 0, int nt = 0);
@@ -82,16 +110,27 @@ public:
   // label for it.  The element chosen is the lexicographically least element; 
   // thus if r \in G the label is rounds.  For part end groups, you typically
   // want right cosets.
+  //
+  // Both take O(n^2) time in the number of bells, rather than O(|G|).
+  // Right coset labels are found by building a tree of point stabilizers 
+  // which is cached (and shared between copies of the group) as it 
+  // is needed.  This is safe to do from several threads at once.
   row rcoset_label( row const& r ) const;
   row lcoset_label( row const& r ) const;
 
   vector<bell> invariants() const;
 
 private:
+  void init( const vector<row>& generators, size_t order_bound = 0 );
+  void enumerate() const;
   void calc_orbit_space() const;
 
-  size_t b;
-  vector<row> v;
+  struct image_node;
+
+  size_t b, n;
+  shared_pointer< stabilizer_chain > chain;
+  mutable vector<row> v; // Created on demand for large groups
+  shared_pointer< image_node > images;
 
   mutable vector< vector<bell> > o; // Created on demand
 };
@@ -62,6 +62,13 @@ void multtab::swap( multtab &other )
   cols.swap( other.cols );
 }
 
+void multtab::clear_columns()
+{
+  for ( size_t i(0); i < table.size(); ++i )
+    table[i].clear();
+  cols.clear();
+}
+
 multtab &multtab::operator=( const multtab &other ) 
 { 
   multtab(other).swap(*this);
@@ -90,6 +97,11 @@ row multtab::make_post_representative( const row& r ) const
 
 row multtab::make_representative( const row& r ) const
 {
+  // Without a post-multiplication group, this is just the right coset
+  // label, which the group can find without iterating over its elements.
+  if ( postgroup.size() < 2 ) 
+    return pends.rcoset_label(r);
+
   row res(r);
 
   for ( group::const_iterator i( pends.begin() ), e( pends.end() ); 
@@ -103,6 +115,66 @@ row multtab::make_representative( const row& r ) const
   return res;
 }
 
+RINGING_START_ANON_NAMESPACE
+
+class store_coset_label
+{
+public:
+  store_coset_label( group const& g, vector<row>& labels )
+    : g(g), labels(labels) {}
+
+  void operator()( row const& r, size_t i ) const
+    { labels[i] = g.rcoset_label(r); }
+
+private:
+  group const& g;
+  vector<row>& labels;
+};
+
+RINGING_END_ANON_NAMESPACE
+
+template <class Extent>
+void multtab::init_from_extent( const Extent& e )
+{
+  // make_post_representative needs the complete list of rows
+  if ( postgroup.size() > 1 ) {
+    init( make_vector( e.begin(), e.end() ) );
+    return;
+  }
+
+  // Without a postgroup, the representative is just the right coset
+  // label, which can safely be found concurrently.
+  vector<row> labels( e.size() );
+  parallel_for_each_row( e, store_coset_label( pends, labels ) );
+
+  // Extents are in lexicographical order, so only need sorting if the 
+  // labels are not the rows themselves.
+  if ( pends.size() > 1 ) {
+    sort( labels.begin(), labels.end() );
+    labels.erase( unique( labels.begin(), labels.end() ), labels.end() );
+  }
+
+  // TODO:  Better error checking for this:
+  assert( labels.size() == e.size() / pends.size() );
+
+  rows.swap( labels );
+  table.resize( rows.size() );
+}
+
+multtab::multtab( const extent& e, const group& partends, 
+                  const group& postgroup )
+  : pends( partends ), postgroup( postgroup )
+{
+  init_from_extent(e);
+}
+
+multtab::multtab( const incourse_extent& e, const group& partends, 
+                  const group& postgroup )
+  : pends( partends ), postgroup( postgroup )
+{
+  init_from_extent(e);
+}
+
 void multtab::init( const vector< row >& r )
 {
   // This, and the two functions above, are complicated by having to
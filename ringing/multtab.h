@@ -33,6 +33,7 @@
 
 #include <ringing/row.h>
 #include <ringing/group.h>
+#include <ringing/extent.h>
 #if RINGING_OLD_INCLUDES
 #include <iosfwd.h>
 #include <vector.h>
@@ -230,6 +231,9 @@ RINGING_END_DETAILS_NAMESPACE
 class RINGING_API multtab
 {
 public:
+  // An empty table, with no rows
+  multtab() {}
+
   // A swap function and assignment operator
   void swap( multtab &other );
   multtab &operator=( const multtab &other );
@@ -260,6 +264,18 @@ public:
     : pends( partends ), postgroup( postgroup )
   { init( make_vector( first, last ) ); }
 
+  // Initialises a multiplication table with the rows of an extent, 
+  // factoring out the part end group and postgroup as above.  Unless
+  // there is a postgroup, the cosets are found using several threads,
+  // and without storing the whole extent.
+  explicit multtab( const extent& e, const group& partends = group(),
+                    const group& postgroup = group() );
+
+  // ... And similarly with the rows of an in-course half-extent.
+  explicit multtab( const incourse_extent& e, 
+                    const group& partends = group(),
+                    const group& postgroup = group() );
+
   typedef RINGING_DETAILS_PREFIX multtab_row_t      row_t;
   typedef RINGING_DETAILS_PREFIX multtab_post_col_t post_col_t;
   typedef RINGING_DETAILS_PREFIX multtab_pre_col_t  pre_col_t;
@@ -274,6 +290,12 @@ public:
   post_col_t compute_post_mult( const row &x ); // (r * x) for all rows r
   post_col_t compute_post_mult( const change &c ) 
     { return compute_post_mult( row() * c ); }
+
+  // The number of precomputed columns, and a function to discard them
+  // all, keeping the rows, so that the table can be reused for products
+  // with other rows.  Any pre_col_t or post_col_t is invalidated.
+  size_t columns() const { return cols.size(); }
+  void clear_columns();
   
   // Convert a row into a precomputed table offset & vice versa
   row_t find( const row &r ) const;
@@ -315,6 +337,7 @@ private:
   row make_post_representative( const row &r ) const;
 
   void init( const vector< row > &r );
+  template <class Extent> void init_from_extent( const Extent& e );
 
   // Data members
   //
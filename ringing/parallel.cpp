@@ -0,0 +1,172 @@
+// parallel.cpp - Simple support for running loops in parallel
+// Copyright (C) 2014 Richard Smith <richard@ex-parrot.com>
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+// $Id$
+
+#include <ringing/common.h>
+
+#if RINGING_HAS_PRAGMA_INTERFACE
+#pragma implementation
+#endif
+
+#include <ringing/parallel.h>
+
+#if RINGING_OLD_INCLUDES
+#include <vector.h>
+#include <stdexcept.h>
+#include <string.h>
+#else
+#include <vector>
+#include <stdexcept>
+#include <string>
+#endif
+
+#if RINGING_USE_THREADS
+#include <unistd.h>
+#include <sys/time.h>
+#else
+#if RINGING_OLD_C_INCLUDES
+#include <time.h>
+#else
+#include <ctime>
+#endif
+#endif
+
+RINGING_START_NAMESPACE
+
+RINGING_USING_STD
+
+#if RINGING_USE_THREADS
+
+mutex::mutex()         { pthread_mutex_init( &m, NULL ); }
+mutex::~mutex()        { pthread_mutex_destroy( &m ); }
+void mutex::lock()     { pthread_mutex_lock( &m ); }
+void mutex::unlock()   { pthread_mutex_unlock( &m ); }
+
+unsigned default_thread_count()
+{
+  long const n = sysconf( _SC_NPROCESSORS_ONLN );
+  return n > 1 ? unsigned(n) : 1u;
+}
+
+double wall_clock()
+{
+  struct timeval tv;
+  gettimeofday( &tv, NULL );
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+RINGING_START_ANON_NAMESPACE
+
+// The state shared between the threads of a call to run_parallel
+struct parallel_state
+{
+  parallel_state( parallel_task& t, size_t n )
+    : t(t), n(n), next(0), failed(false) {}
+
+  parallel_task& t;
+  size_t const n;
+
+  mutex m;          // Protects the following
+  size_t next;      // The next part to hand out
+  bool failed;      // Has a part thrown an exception?
+  string what;      // If so, its message
+};
+
+extern "C" void* run_parallel_thread( void* arg )
+{
+  parallel_state& s = *static_cast<parallel_state*>(arg);
+
+  while (true) {
+    size_t i;
+    {
+      mutex::scoped_lock l( s.m );
+      if ( s.failed || s.next == s.n ) break;
+      i = s.next++;
+    }
+
+    try {
+      s.t.run(i);
+    }
+    catch ( exception const& e ) {
+      mutex::scoped_lock l( s.m );
+      if ( !s.failed ) { s.failed = true; s.what = e.what(); }
+    }
+    catch ( ... ) {
+      mutex::scoped_lock l( s.m );
+      if ( !s.failed ) { s.failed = true; s.what = "Unknown exception"; }
+    }
+  }
+
+  return NULL;
+}
+
+RINGING_END_ANON_NAMESPACE
+
+void run_parallel( parallel_task& t, size_t n, unsigned threads )
+{
+  if ( threads == 0 ) threads = default_thread_count();
+  if ( threads > n ) threads = n;
+
+  if ( threads < 2 ) {
+    for ( size_t i = 0; i < n; ++i ) t.run(i);
+    return;
+  }
+
+  parallel_state s( t, n );
+
+  // The calling thread does its share of the work too
+  vector<pthread_t> ids( threads - 1 );
+  size_t started = 0;
+  for ( ; started < ids.size(); ++started )
+    if ( pthread_create( &ids[started], NULL, &run_parallel_thread, &s ) )
+      break;  // Carry on with the threads we've got
+
+  run_parallel_thread( &s );
+
+  for ( size_t i = 0; i < started; ++i )
+    pthread_join( ids[i], NULL );
+
+  if ( s.failed )
+    throw runtime_error( s.what );
+}
+
+#else
+
+mutex::mutex()         {}
+mutex::~mutex()        {}
+void mutex::lock()     {}
+void mutex::unlock()   {}
+
+unsigned default_thread_count()
+{
+  return 1u;
+}
+
+double wall_clock()
+{
+  return double( clock() ) / CLOCKS_PER_SEC;
+}
+
+void run_parallel( parallel_task& t, size_t n, unsigned )
+{
+  for ( size_t i = 0; i < n; ++i ) t.run(i);
+}
+
+#endif // RINGING_USE_THREADS
+
+RINGING_END_NAMESPACE
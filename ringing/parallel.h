@@ -0,0 +1,145 @@
+// -*- C++ -*- parallel.h - Simple support for running loops in parallel
+// Copyright (C) 2014 Richard Smith <richard@ex-parrot.com>
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+// $Id$
+
+#ifndef RINGING_PARALLEL_H
+#define RINGING_PARALLEL_H
+
+#include <ringing/common.h>
+
+#if RINGING_HAS_PRAGMA_ONCE
+#pragma once
+#endif
+
+#if RINGING_HAS_PRAGMA_INTERFACE
+#pragma interface
+#endif
+
+#if RINGING_USE_THREADS
+#include <pthread.h>
+#endif
+
+RINGING_START_NAMESPACE
+
+RINGING_USING_STD
+
+// --------------------------------------------------------------
+//
+// A mutex.  If the library was built without thread support, this
+// does nothing.
+//
+class RINGING_API mutex
+{
+public:
+  mutex();
+ ~mutex();
+
+  void lock();
+  void unlock();
+
+  // Locks the mutex for the lifetime of the object.
+  class scoped_lock
+  {
+  public:
+    explicit scoped_lock( mutex& m ) : m(m) { m.lock(); }
+   ~scoped_lock() { m.unlock(); }
+
+  private:
+    // Unimplemented to prevent copying
+    scoped_lock( scoped_lock const& );
+    scoped_lock& operator=( scoped_lock const& );
+
+    mutex& m;
+  };
+
+private:
+  // Unimplemented to prevent copying
+  mutex( mutex const& );
+  mutex& operator=( mutex const& );
+
+#if RINGING_USE_THREADS
+  pthread_mutex_t m;
+#endif
+};
+
+// --------------------------------------------------------------
+//
+// The number of threads to use by default: the number of processors
+// available, or 1 if the library was built without thread support.
+//
+RINGING_API unsigned default_thread_count();
+
+// --------------------------------------------------------------
+//
+// The time in seconds since some fixed point, for timing searches.
+// Unlike clock(), this measures elapsed time, not processor time used
+// by all of the threads.  Without thread support, it is clock().
+//
+RINGING_API double wall_clock();
+
+// --------------------------------------------------------------
+//
+// A task that can be run in parallel by run_parallel.
+//
+class RINGING_API parallel_task
+{
+public:
+  virtual ~parallel_task() {}
+
+  // Carry out the ith part of the task.  This will be called
+  // concurrently from several threads, for different i.
+  virtual void run( size_t i ) = 0;
+};
+
+// Call t.run(i) for each 0 <= i < n, using up to the specified number
+// of threads (or default_thread_count() threads, if threads is 0).  The
+// values of i are handed out to threads in increasing order as each
+// thread becomes free, so expensive parts are best placed first.  If
+// threads is 1, or n is less than 2, everything is done in the calling
+// thread.  If a part throws an exception, no further parts are started,
+// and once the running ones have finished, the exception is rethrown
+// in the calling thread (as a runtime_error, unless threads is 1).
+RINGING_API void run_parallel( parallel_task& t, size_t n,
+                               unsigned threads = 0 );
+
+RINGING_START_DETAILS_NAMESPACE
+
+template <class Function>
+class parallel_function : public parallel_task
+{
+public:
+  explicit parallel_function( Function& f ) : f(f) {}
+  virtual void run( size_t i ) { f(i); }
+
+private:
+  Function& f;
+};
+
+RINGING_END_DETAILS_NAMESPACE
+
+// Call f(i) for each 0 <= i < n in parallel, as run_parallel.
+template <class Function>
+void parallel_for( size_t n, Function f, unsigned threads = 0 )
+{
+  RINGING_DETAILS_PREFIX parallel_function<Function> t(f);
+  run_parallel( t, n, threads );
+}
+
+RINGING_END_NAMESPACE
+
+#endif // RINGING_PARALLEL_H
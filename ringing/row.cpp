@@ -481,6 +481,18 @@ row row::power( int n ) const
   }
 }
 
+bool row::next_permutation(int first, int last)
+{
+  return RINGING_PREFIX_STD next_permutation( data.begin() + first, 
+                                              data.begin() + last );
+}
+
+bool row::prev_permutation(int first, int last)
+{
+  return RINGING_PREFIX_STD prev_permutation( data.begin() + first, 
+                                              data.begin() + last );
+}
+
 void row::resize(int b)
 {
   if ( b < data.size() ) {
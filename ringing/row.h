@@ -153,6 +153,13 @@ public:
 
   void resize(int b); // Truncate (or pad) to b bells or throw invalid
 
+  // Rearrange the bells in positions [first, last) into the next (or 
+  // previous) arrangement in lexicographical order, in place.  Returns 
+  // false, leaving them in the first (or last) arrangement, if there 
+  // is none.  These are as std::next_permutation and prev_permutation.
+  bool next_permutation(int first, int last);
+  bool prev_permutation(int first, int last);
+
 private:
   void validate() const;
 };
@@ -25,15 +25,120 @@
 
 #include <ringing/search_base.h>
 #include <ringing/pointers.h>
+#include <ringing/lexical_cast.h>
+#include <ringing/parallel.h>
+#if RINGING_OLD_INCLUDES
+#include <stdexcept.h>
+#else
+#include <stdexcept>
+#endif
+#if RINGING_OLD_C_INCLUDES
+#include <ctype.h>
+#else
+#include <cctype>
+#endif
 
 RINGING_START_NAMESPACE
 
 RINGING_USING_STD
 
+string search_base::format_position( const position &p )
+{
+  make_string s;
+  for ( position::const_iterator i( p.begin() ), e( p.end() ); i != e; ++i ) 
+    {
+      if ( i != p.begin() ) s << '.';
+      s << *i;
+    }
+  return s;
+}
+
+search_base::position search_base::parse_position( const string &s )
+{
+  position p;
+  for ( string::const_iterator i( s.begin() ), e( s.end() ); i != e; ) 
+    {
+      // Every number after the first is preceded by a dot
+      bool const dot = p.empty() || *i++ == '.';
+      if ( !dot || i == e || !isdigit(*i) )
+        throw runtime_error( make_string() << "Invalid search position '"
+                             << s << "'" );
+      size_t n = 0;
+      for ( ; i != e && isdigit(*i); ++i )
+        n = n * 10 + (*i - '0');
+      p.push_back(n);
+    }
+  return p;
+}
+
+search_base::statistics::statistics()
+  : nodes(0), touches(0), false_nodes(0), non_canonical(0), too_long(0),
+    bounded(0), elapsed(0), estimated_nodes(0)
+{}
+
+search_base::statistics &
+search_base::statistics::operator+=( const statistics &o )
+{
+  nodes += o.nodes;  touches += o.touches;  false_nodes += o.false_nodes;
+  non_canonical += o.non_canonical;  too_long += o.too_long;
+  bounded += o.bounded;
+
+  if ( depths.size() < o.depths.size() ) 
+    depths.resize( o.depths.size() );
+  for ( size_t i = 0; i < o.depths.size(); ++i )
+    depths[i] += o.depths[i];
+
+  return *this;
+}
+
+search_base::progress_meter::progress_meter( const search_base &s )
+  : interval( s.progress_interval ), start_time(0), next_time(0)
+{}
+
+void search_base::progress_meter::start()
+{
+  stats = statistics();
+  start_time = wall_clock();
+  next_time = start_time + interval;
+}
+
+bool search_base::progress_meter::due() const
+{
+  return interval > 0 && wall_clock() >= next_time;
+}
+
+void search_base::progress_meter::report( outputer &o )
+{
+  if ( interval > 0 ) {
+    double const now = wall_clock();
+    stats.elapsed = now - start_time;
+    next_time = now + interval;
+    o.progress( stats );
+  }
+}
+
+void search_base::check_range( context_base const& ctx ) const
+{
+  if ( ( range_first.size() || range_last.size() ) && !ctx.supports_ranges() )
+    throw logic_error( "This search cannot be restricted to a range" );
+}
+
 void search_base::run( search_base::outputer &o ) const
 {
   scoped_pointer< context_base > ctx( new_context() );
+  check_range( *ctx );
   ctx->run( o );
 }
 
+void search_base::run( search_base::outputer &o, unsigned threads, 
+                       bool in_order ) const
+{
+  scoped_pointer< context_base > ctx( new_context() );
+  check_range( *ctx );
+  if ( threads == 1 )
+    ctx->run( o );
+  else
+    ctx->run( o, threads, in_order );
+}
+
 RINGING_END_NAMESPACE
@@ -30,15 +30,103 @@
 #pragma interface
 #endif
 
+#if RINGING_OLD_INCLUDES
+#include <vector.h>
+#include <string.h>
+#else
+#include <vector>
+#include <string>
+#endif
+
 RINGING_START_NAMESPACE
 
+RINGING_USING_STD
+
 class touch;
 
 class RINGING_API search_base
 {
 public:
+  search_base() : progress_interval(0) {}
   virtual ~search_base() {}
 
+  // A position in the search tree: the choice made at each level on the
+  // way to a node (in a table_search, the index of each call, with 0 
+  // being the plain lead).  Positions are compared lexicographically, 
+  // which is the order in which a search reaches them.  They are written
+  // as the choices separated by dots, with the root as an empty string.
+  typedef vector<size_t> position;
+  static string format_position( const position &p );
+  static position parse_position( const string &s );
+
+  // Statistics about a search, as passed to outputer::progress.  The
+  // nodes that are leaves of the search tree are counted by why the 
+  // search went no deeper.
+  struct RINGING_API statistics
+  {
+    statistics();
+
+    // Add the node counts of another set of statistics
+    statistics &operator+=( const statistics &o );
+
+    RINGING_ULLONG nodes;		// Nodes visited
+    RINGING_ULLONG touches;		// Touches passed to the outputer
+    RINGING_ULLONG false_nodes;		// Leaves false against earlier leads
+    RINGING_ULLONG non_canonical;	// Leaves pruned by symmetry
+    RINGING_ULLONG too_long;		// Leaves at the maximum length
+    RINGING_ULLONG bounded;		// Leaves that could score too little
+    vector< RINGING_ULLONG > depths;	// Nodes visited at each depth
+    double elapsed;			// Seconds since the search started
+    double estimated_nodes;		// The estimated total, or 0 if unknown
+  };
+
+  // A touch found by a search, given as the calls used in one part:
+  // the index of the call at the end of each lead, with 0 being the 
+  // plain lead, and the number of times that is repeated to come round.
+  // Searches that score touches also give the score, and spliced 
+  // searches the index of the method rung in each lead.
+  // This is much cheaper for a search to produce than a touch, which is
+  // only built if get_touch() is called.  Neither the calls nor the 
+  // touch remain valid after the outputer returns.
+  class RINGING_API call_sequence
+  {
+  public:
+    // Builds the touch from a call sequence
+    class builder
+    {
+    public:
+      virtual const touch &make_touch( const call_sequence &c ) = 0;
+      virtual ~builder() {}
+    };
+
+    typedef const size_t *const_iterator;
+
+    call_sequence( const_iterator first, const_iterator last, 
+                   unsigned parts, builder &b, int score = 0,
+                   const_iterator meths = 0 )
+      : first(first), last(last), meths(meths), n(parts), s(score), 
+        b(&b), t(0) {}
+
+    const_iterator begin() const { return first; }
+    const_iterator end() const { return last; }
+    size_t size() const { return last - first; }
+    size_t operator[]( size_t i ) const { return first[i]; }
+
+    unsigned parts() const { return n; }
+    int score() const { return s; }
+    size_t method_index( size_t i ) const { return meths ? meths[i] : 0; }
+
+    const touch &get_touch() const 
+      { if ( !t ) t = &b->make_touch( *this );  return *t; }
+
+  private:
+    const_iterator first, last, meths;
+    unsigned n;
+    int s;
+    builder *b;
+    mutable const touch *t;
+  };
+
   class outputer
   {
   public:
@@ -46,20 +134,101 @@ public:
 
     // Returns true if the search should halt
     virtual bool operator()( const touch &t ) = 0;
+
+    // Called instead of the above by searches that can give touches as
+    // call sequences.  By default it builds the touch and passes that on.
+    virtual bool operator()( const call_sequence &c ) 
+      { return (*this)( c.get_touch() ); }
+
+    // Called from time to time with the position of the search.  A 
+    // search restricted to start at that position will find exactly
+    // those touches that have not yet been output, so saving it allows
+    // an interrupted search to be resumed.  Searches that do not support
+    // ranges never call this, and nor does a search on several threads
+    // unless its output is in order.
+    virtual void checkpoint( const position & ) {}
+
+    // Called from the searching thread with the statistics so far,
+    // every progress interval and once more when the search finishes.
+    virtual void progress( const statistics & ) {}
   };
 
+  // Have the outputer told of the progress of the search every so 
+  // many seconds, or never if this is 0 (the default).  The searches 
+  // check the time every few thousand nodes, so the interval is not 
+  // exact.  Searches that can estimate the size of the search tree do 
+  // so before they start if this is set.
+  void set_progress_interval( double seconds ) 
+    { progress_interval = seconds; }
+  double get_progress_interval() const { return progress_interval; }
+
+  // Restrict the search to the nodes from first, inclusive, to last, 
+  // exclusive; if last is empty, there is no upper limit.  Searches 
+  // restricted to [a, b) and [b, c) between them find the same touches 
+  // as one restricted to [a, c), so a large search can be split up by
+  // prefixes of its tree.  Touches are found at the nodes where they 
+  // come round.  Running a search that does not support ranges with a 
+  // range set throws logic_error.
+  void set_range( const position &first, const position &last = position() )
+    { range_first = first; range_last = last; }
+
+  const position &get_range_first() const { return range_first; }
+  const position &get_range_last() const { return range_last; }
+
   void run( outputer &o ) const;
 
+  // Run the search using up to the given number of threads, or
+  // default_thread_count() threads if threads is 0.  The outputer is
+  // never called concurrently.  Unless in_order is true, touches are
+  // passed to it in the order they are found, which varies from run to
+  // run; if it is, they are passed in the same order as a search with
+  // a single thread would, at the cost of holding on to touches found
+  // early in the search.  Searches that cannot be split between threads
+  // ignore these arguments.
+  void run( outputer &o, unsigned threads, bool in_order = false ) const;
+
 RINGING_PROTECTED_IMPL:
   class RINGING_API context_base
   {
   public:
     virtual void run( outputer & ) = 0;
+    virtual void run( outputer &o, unsigned threads, bool in_order ) 
+      { run(o); }
+    virtual bool supports_ranges() const { return false; }
     virtual ~context_base() {}
   };
 
+  // Used by the searches to keep the statistics for a run and pass
+  // them to the outputer every progress interval.
+  class RINGING_API progress_meter
+  {
+  public:
+    explicit progress_meter( const search_base &s );
+
+    // Are progress reports wanted?
+    bool enabled() const { return interval > 0; }
+
+    // Start timing a run
+    void start();
+
+    // Is it time to pass the statistics to the outputer?
+    bool due() const;
+
+    // Pass the statistics to the outputer, if the interval is non-zero
+    void report( outputer &o );
+
+    statistics stats;
+
+  private:
+    double interval, start_time, next_time;
+  };
+
 private:
   virtual context_base *new_context() const = 0;
+  void check_range( context_base const& ctx ) const;
+
+  position range_first, range_last;
+  double progress_interval;
 };
 
 
@@ -108,22 +277,24 @@ RINGING_END_DETAILS_NAMESPACE
 
 template < class OutputIterator > 
 void touch_search( const search_base &searcher, 
-		   const OutputIterator &iter )
+		   const OutputIterator &iter,
+		   unsigned threads = 1, bool in_order = false )
 {
   RINGING_USING_DETAILS
   search_output< OutputIterator > o( iter );
-  searcher.run( o );
+  searcher.run( o, threads, in_order );
 }
 
 
 template < class OutputIterator, class UnaryPredicate > 
 void touch_search_until( const search_base &searcher, 
 		         const OutputIterator &iter,
-		         const UnaryPredicate &terminate )
+		         const UnaryPredicate &terminate,
+		         unsigned threads = 1, bool in_order = false )
 {
   RINGING_USING_DETAILS
   search_output_until< OutputIterator, UnaryPredicate > o( iter, terminate );
-  searcher.run( o );
+  searcher.run( o, threads, in_order );
 }
 
 RINGING_END_NAMESPACE
@@ -0,0 +1,419 @@
+// -*- C++ -*- spliced_search.cpp - A search for touches of spliced methods
+// Copyright (C) 2014 Richard Smith <richard@ex-parrot.com>
+
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+// $Id$
+
+#include <ringing/common.h>
+
+#if RINGING_HAS_PRAGMA_INTERFACE
+#pragma implementation
+#endif
+
+#if RINGING_OLD_INCLUDES
+#include <vector.h>
+#include <list.h>
+#include <algo.h>
+#else
+#include <vector>
+#include <list>
+#include <algorithm>
+#endif
+#include <ringing/search_base.h>
+#include <ringing/spliced_search.h>
+#include <ringing/falseness.h>
+#include <ringing/multtab.h>
+#include <ringing/extent.h>
+#include <ringing/touch.h>
+#include <ringing/group.h>
+
+RINGING_START_NAMESPACE
+
+RINGING_USING_STD
+
+spliced_search::spliced_search( const vector<method> &meths,
+                                const vector<change> &calls,
+                                const group& partends,
+                                pair< size_t, size_t > lenrange, flags f )
+  : meths( meths ), calls( calls ), partends( partends ),
+    lenrange( lenrange ), com( size_t(0), size_t(-1) ), f( f )
+{}
+
+class spliced_search::context : public search_base::context_base,
+                                private search_base::call_sequence::builder
+{
+public:
+  context( const spliced_search *s )
+    : lenrange( s->lenrange ), com( s->com ), f( s->f ),
+      table( make_table( s ) ),
+      nmeths( s->meths.size() ), nchoices( s->calls.size() + 1 ),
+      meter( *s )
+  {
+    init_choices( s );
+    init_falseness( s );
+
+    rotations = table.partends().size() == 1;
+    output_rotations = rotations && !(f & ignore_rotations);
+  }
+
+private:
+  typedef multtab::post_col_t post_col_t;
+  typedef multtab::row_t row_t;
+
+  static bool is_in_course( const spliced_search *s )
+  {
+    if ( s->meths.empty() ) return true;
+    int const psign = s->meths[0].back().sign();
+
+    for ( vector<method>::const_iterator i( s->meths.begin() );
+          i != s->meths.end(); ++i )
+      if ( i->lh().sign() == -1 || i->back().sign() != psign )
+        return false;
+
+    for ( size_t i=0; i < s->calls.size(); ++i )
+      if ( s->calls[i].sign() != psign )
+        return false;
+
+    return true;
+  }
+
+  static bool is_fixed_treble( const spliced_search *s )
+  {
+    for ( vector<method>::const_iterator i( s->meths.begin() );
+          i != s->meths.end(); ++i )
+      if ( i->lh()[0] || !i->back().findplace(0) )
+        return false;
+
+    for ( size_t i=0; i < s->calls.size(); ++i )
+      if ( !s->calls[i].findplace(0) )
+	return false;
+
+    return true;
+  }
+
+  static multtab make_table( const spliced_search *s )
+  {
+    int const bells = s->meths.empty() ? 0 : s->meths[0].bells();
+    if ( is_fixed_treble(s) )
+      return multtab( extent( bells - 1, 1 ), s->partends );
+    else
+      return multtab( extent( bells ), s->partends );
+  }
+
+  // Each lead is a choice of method and call, numbered method by method
+  // with the plain lead first.  The touch has a node for the body of
+  // each method, the lead end change of each choice, and each whole lead.
+  void init_choices( const spliced_search *s )
+  {
+    for ( size_t m = 0; m < nmeths; ++m )
+      t.push_back( new touch_changes( s->meths[m].begin(),
+                                      s->meths[m].end()-1 ) );
+
+    for ( size_t m = 0; m < nmeths; ++m ) {
+      const method &meth = s->meths[m];
+      row le;
+      for_each( meth.begin(), meth.end()-1, permute(le) );
+
+      units.push_back( f & length_in_changes
+                         ? meth.size() * table.partends().size() : 1 );
+
+      for ( size_t c = 0; c < nchoices; ++c ) {
+        change const &ch = c ? s->calls[c-1] : meth.back();
+
+        touch_changes *tc;  touch_child_list *cl;
+        t.push_back( tc = new touch_changes() );
+        tc->push_back( ch );
+        t.push_back( cl = new touch_child_list );
+        cl->push_back( 1, t.get_node(m) );
+        cl->push_back( 1, tc );
+        lead_nodes.push_back( nmeths + 2 * (m * nchoices + c) + 1 );
+
+        choice_rows.push_back( le * ch );
+        choice_lhs.push_back( table.compute_post_mult( choice_rows.back() ) );
+      }
+    }
+
+    t.push_back( tl = new touch_child_list );
+    t.set_head( tl );
+  }
+
+  // The columns of the table giving the lead heads at which each method
+  // is false against a lead of each method starting at a lead head.  A
+  // method whose lead is false against itself in another part can't be
+  // used at all.
+  void init_falseness( const spliced_search *s )
+  {
+    int const ft_flags
+      = (is_fixed_treble(s) ? 0 : falseness_table::no_fixed_treble)
+      | (!is_in_course(s)   ? 0 : falseness_table::in_course_only );
+
+    falsenesses.resize( nmeths );
+    usable.assign( nmeths, true );
+
+    for ( size_t a = 0; a < nmeths; ++a )
+      for ( size_t b = 0; b < nmeths; ++b ) {
+        falseness_table ft( s->meths[a], s->meths[b], ft_flags );
+        for ( falseness_table::const_iterator i( ft.begin() );
+              i != ft.end(); ++i ) {
+          if ( a == b && !i->isrounds()
+               && find( table.partends().begin(), table.partends().end(),
+                        *i ) != table.partends().end() )
+            usable[a] = false;
+
+          falsenesses[a].push_back
+            ( false_col( table.compute_post_mult( *i ), b ) );
+        }
+      }
+  }
+
+  virtual void run( outputer &o )
+  {
+    out = &o;  halted = false;  nodes = 0;
+    meter.start();
+
+    leads.assign( table.size(), 0 );
+    run_recursive( row_t(), 0, 0, 0, 0 );
+
+    meter.report( *out );
+  }
+
+  // The column of the table for the lead head that a lead gives, with
+  // the method of the earlier lead that is false against it
+  struct false_col
+  {
+    false_col( const post_col_t &col, size_t meth )
+      : col( col ), meth( meth ) {}
+
+    post_col_t col;
+    size_t meth;
+  };
+
+  // Is the lead of method m starting at r false against an earlier lead?
+  bool is_lead_false( const row_t &r, size_t m ) const
+  {
+    for ( vector< false_col >::const_iterator i( falsenesses[m].begin() ),
+            e( falsenesses[m].end() ); i != e; ++i )
+      if ( leads[ (r * i->col).index() ] == i->meth + 1 )
+        return true;
+    return false;
+  }
+
+  // The number of changes of method in the touch, including the one
+  // where it joins back to the start
+  size_t changes_of_method( size_t changes ) const
+  {
+    return changes + ( meths.size() > 1 && meths.back() != meths.front() );
+  }
+
+  // The main loop of the algorithm.  The node is reached by the choices
+  // so far, giving a touch of length len with changes changes of method,
+  // and r is the next lead head.
+  void run_recursive( const row_t &r, size_t depth, size_t cur,
+                      size_t len, size_t changes )
+  {
+    if ( ++nodes % poll_interval == 0 && meter.due() )
+      meter.report( *out );
+
+    statistics &st = meter.stats;
+    ++st.nodes;
+    if ( depth >= st.depths.size() )
+      st.depths.resize( depth + 1 );
+    ++st.depths[depth];
+
+    // Is the touch lexicographically no greater than any of it's rotations?
+    if ( !is_possibly_canonical( cur ) ) {
+      ++st.non_canonical;
+      return;
+    }
+
+    // Has the touch come round, or become false?
+    bool false_node = leads[ r.index() ] != 0;
+    if ( !false_node && (f & non_round_blocks) ) {
+      false_node = true;
+      for ( size_t m = 0; false_node && m < nmeths; ++m )
+        if ( usable[m] && !is_lead_false( r, m ) )
+          false_node = false;
+    }
+
+    if ( false_node ) {
+      ++st.false_nodes;
+      if ( depth && len >= lenrange.first
+           && ( (f & non_round_blocks) || r.isrounds() )
+           && changes_of_method( changes ) >= com.first
+           && changes_of_method( changes ) <= com.second
+           && is_really_canonical() )
+        halted = output_touch();
+      return;
+    }
+
+    for ( size_t m = 0; !halted && m < nmeths; ++m ) {
+      if ( !usable[m] )
+        continue;
+
+      if ( len + units[m] > lenrange.second ) {
+        ++st.too_long;
+        continue;
+      }
+
+      size_t const c = changes + ( depth && m != meths.back() );
+      if ( c > com.second )
+        continue;
+
+      if ( is_lead_false( r, m ) ) {
+        ++st.false_nodes;
+        continue;
+      }
+
+      leads[ r.index() ] = m + 1;
+      meths.push_back( m );
+      for ( size_t k = m * nchoices; !halted && k < (m+1) * nchoices; ++k ) {
+        choices.push_back( k );
+        run_recursive( r * choice_lhs[k], depth + 1, cur, len + units[m], c );
+        choices.pop_back();
+      }
+      meths.pop_back();
+      leads[ r.index() ] = 0;
+    }
+  }
+
+  // As table_search: returns true if the choices so far could be the
+  // start of a canonical touch, keeping track of its possible period.
+  bool is_possibly_canonical( size_t &cur ) const
+  {
+    if ( choices.empty() || !rotations )
+      return true;
+
+    size_t const n = choices.size();
+    if ( cur == 0 || choices.back() > choices[ n - 1 - cur ] )
+      cur = n;
+    else if ( choices.back() < choices[ n - 1 - cur ] )
+      return false;
+
+    return true;
+  }
+
+  // ... and checks all the rotations of a complete touch
+  bool is_really_canonical() const
+  {
+    if ( !rotations ) return true;
+
+    size_t const n = choices.size();
+    for ( size_t j = 1; j < n; ++j )
+      for ( size_t i = 0; i < n; ++i ) {
+        size_t const c = choices[ (j + i) % n ];
+        if ( c < choices[i] ) return false;
+        if ( c > choices[i] ) break;
+      }
+    return true;
+  }
+
+  // The shortest period of a touch: the number of its distinct rotations
+  static size_t period( const vector< size_t > &calls )
+  {
+    size_t const n = calls.size();
+    for ( size_t p = 1; p < n; ++p )
+      if ( n % p == 0 && equal( calls.begin() + p, calls.end(), 
+                                calls.begin() ) )
+        return p;
+    return n;
+  }
+
+  // Output the touch and any rotations of it.  Returns true if the
+  // search should halt.
+  bool output_touch()
+  {
+    size_t const len( choices.size() );
+
+    row end( table.bells() );
+    for ( size_t i = 0; i < len; ++i )
+      end *= choice_rows[ choices[i] ];
+    unsigned const parts( end.order() );
+
+    if ( !(f & mutually_true_parts) && table.partends().size() > 1
+         && parts != table.partends().size() )
+      return false;
+
+    // The rotations are windows onto the calls and methods repeated twice
+    rotated_calls.resize( 2 * len );  rotated_meths.resize( 2 * len );
+    for ( size_t i = 0; i < 2 * len; ++i ) {
+      rotated_calls[i] = choices[ i % len ] % nchoices;
+      rotated_meths[i] = choices[ i % len ] / nchoices;
+    }
+
+    size_t const n = output_rotations ? period( choices ) : 1;
+    bool force_halt = false;
+    for ( size_t start = 0; !force_halt && start < n; ++start ) {
+      force_halt = (*out)( call_sequence( &rotated_calls[start],
+                                          &rotated_calls[start] + len,
+                                          parts, *this, 0,
+                                          &rotated_meths[start] ) );
+      ++meter.stats.touches;
+    }
+    return force_halt;
+  }
+
+  // Build the touch for a call sequence when the outputer asks for it
+  virtual const touch &make_touch( const call_sequence &c )
+  {
+    list< touch_child_list::entry > &ch = tl->children();
+    ch.clear();
+    for ( size_t i = 0; i < c.size(); ++i )
+      tl->push_back( 1, t.get_node( lead_nodes[ c.method_index(i) * nchoices
+                                                + c[i] ] ) );
+    return t;
+  }
+
+  // How often the statistics are checked
+  static size_t const poll_interval = 4096;
+
+  // Data members
+  pair< size_t, size_t > lenrange;	// The min & max lengths
+  pair< size_t, size_t > com;		// The min & max changes of method
+  flags f;
+  multtab table;			// A precomputed multiplication table
+  size_t nmeths, nchoices;		// Methods and calls (inc. Pl.)
+  bool rotations;			// Prune rotations?
+  bool output_rotations;		// ... and output them with the touch?
+
+  vector< post_col_t > choice_lhs;	// The effect of each choice
+  vector< row > choice_rows;		// ... as the lead head it gives
+  vector< size_t > units;		// The length of each method's lead
+  vector< vector< false_col > > falsenesses;  // For each method
+  vector< bool > usable;		// Can each method be used?
+
+  touch t;				// The current touch
+  touch_child_list *tl;
+  vector< size_t > lead_nodes;		// The node of t for each choice
+
+  // The state of the current run
+  outputer *out;
+  bool halted;
+  RINGING_ULLONG nodes;
+  vector< size_t > leads;		// The method at each lead head, + 1
+  vector< size_t > choices;		// The choices so far
+  vector< size_t > meths;		// ... and their methods
+  vector< size_t > rotated_calls, rotated_meths;
+  progress_meter meter;
+};
+
+size_t const spliced_search::context::poll_interval;
+
+search_base::context_base *spliced_search::new_context() const
+{
+  return new context( this );
+}
+
+RINGING_END_NAMESPACE
@@ -0,0 +1,98 @@
+// -*- C++ -*- spliced_search.h - A search for touches of spliced methods
+// Copyright (C) 2014 Richard Smith <richard@ex-parrot.com>
+
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+// $Id$
+
+#ifndef RINGING_SPLICED_SEARCH_H
+#define RINGING_SPLICED_SEARCH_H
+
+#include <ringing/common.h>
+
+#if RINGING_HAS_PRAGMA_ONCE
+#pragma once
+#endif
+
+#if RINGING_HAS_PRAGMA_INTERFACE
+#pragma interface
+#endif
+
+#if RINGING_OLD_INCLUDES
+#include <vector.h>
+#else
+#include <vector>
+#endif
+#include <ringing/row.h>
+#include <ringing/method.h>
+#include <ringing/search_base.h>
+#include <ringing/group.h>
+
+RINGING_START_NAMESPACE
+
+RINGING_USING_STD
+
+// A search for touches in which each lead may be of any of several
+// methods, on the same number of bells, and end with any of the calls,
+// which replace the lead end change of whichever method is rung.  It
+// works like table_search, with a multiplication table shared by all of
+// the methods, and checks each lead against the earlier leads using the
+// falseness table of each pair of methods.
+//
+// Touches are passed to the outputer as call_sequences, with the calls
+// numbered from 1 in the order given to the constructor, and the index
+// of the method rung in each lead given by call_sequence::method_index.
+class RINGING_API spliced_search : public search_base
+{
+public:
+  // These have the same meaning as for table_search, except that
+  // ignore_rotations has no effect on multipart searches, and lengths
+  // in changes allow for leads of different lengths.
+  enum flags {
+    no_flags = 0x0,
+    ignore_rotations = 0x01,
+    mutually_true_parts = 0x02,
+    length_in_changes = 0x04,
+    non_round_blocks = 0x08
+  };
+
+  spliced_search( const vector<method> &meths, const vector<change> &calls,
+                  const group& partends, pair< size_t, size_t > lenrange,
+                  flags = no_flags );
+
+  // Only find touches with between min and max changes of method,
+  // counting the change, if any, where the block joins back to its
+  // start.  The default is no limit.
+  void set_changes_of_method( size_t min, size_t max = size_t(-1) )
+    { com = make_pair( min, max ); }
+
+private:
+  // The implementation
+  class context;
+  friend class context;
+  virtual context_base *new_context() const;
+
+  // Data members
+  vector<method> meths;
+  vector<change> calls;
+  group partends;
+  pair< size_t, size_t > lenrange; // The minimum and maximum length
+  pair< size_t, size_t > com;      // ... and changes of method
+  flags f;
+};
+
+RINGING_END_NAMESPACE
+
+#endif // RINGING_SPLICED_SEARCH_H
@@ -0,0 +1,360 @@
+// -*- C++ -*- stabilizer_chain.cpp - Base and strong generating set for a group
+// Copyright (C) 2014 Richard Smith <richard@ex-parrot.com>
+
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+// $Id$
+
+#include <ringing/common.h>
+
+#if RINGING_HAS_PRAGMA_INTERFACE
+#pragma implementation
+#endif
+
+#include <ringing/stabilizer_chain.h>
+#include <ringing/mathutils.h>
+
+#if RINGING_OLD_INCLUDES
+#include <algo.h>
+#include <stdexcept.h>
+#include <limits.h>
+#else
+#include <algorithm>
+#include <stdexcept>
+#include <limits>
+#endif
+#if RINGING_OLD_C_INCLUDES
+#include <assert.h>
+#else
+#include <cassert>
+#endif
+
+RINGING_START_NAMESPACE
+
+RINGING_USING_STD
+
+// The algorithm used is the deterministic, incremental form of the
+// Schreier-Sims algorithm.  Each pair (orbit point, generator) at each
+// level is considered exactly once, and the resulting Schreier generator
+// is sifted through the lower levels of the chain.  Any non-trivial
+// residue is added as a new strong generator at each level from the one
+// below the Schreier generator's down to the level where sifting failed.
+// See, e.g., section 4.4.2 of Holt, Eick & O'Brien, "Handbook of
+// Computational Group Theory" (2005).
+//
+// The product of the orbit lengths is always a lower bound on the order
+// of the group, which allows construction to stop early if a bound
+// is given.
+stabilizer_chain::stabilizer_chain( const vector<row>& generators,
+                                    const vector<bell>& base_prefix,
+                                    RINGING_ULLONG order_bound )
+  : b(0), bound(order_bound), truncated(false)
+{
+  for ( vector<row>::const_iterator i( generators.begin() ),
+          e( generators.end() );  i != e;  ++i )
+    if ( size_t(i->bells()) > b )
+      b = i->bells();
+
+  for ( vector<bell>::const_iterator i( base_prefix.begin() ),
+          e( base_prefix.end() );  i != e;  ++i )
+    if ( size_t(*i) >= b )
+      b = *i + 1;
+
+  // There are at most b levels, and we keep references into the levels,
+  // so must make sure the vector never reallocates.
+  levels.reserve( b + 1 );
+  for ( vector<bell>::const_iterator i( base_prefix.begin() ),
+          e( base_prefix.end() );  i != e;  ++i )
+    add_level( *i );
+
+  // Sifting each generator discards any (such as duplicates) that are 
+  // already known to be in the group, without needing to search gens.
+  for ( vector<row>::const_iterator i( generators.begin() ),
+          e( generators.end() );  i != e && !truncated;  ++i )
+  {
+    row g(*i); g.resize(b);
+    row h(g);
+    size_t const lvl = sift( h, 0 );
+    if ( lvl == levels.size() && h.isrounds() )
+      continue;
+
+    gens.push_back(g);
+    add_generator( 0, lvl, h );
+  }
+}
+
+bool stabilizer_chain::reached_bound() const
+{
+  RINGING_ULLONG o = 1;
+  for ( vector<level>::const_iterator i( levels.begin() ), e( levels.end() );
+        i != e; ++i ) {
+    o *= i->orbit.size();
+    if ( o >= bound ) return true;
+  }
+  return false;
+}
+
+void stabilizer_chain::add_level( bell point )
+{
+  assert( levels.size() < levels.capacity() );
+
+  levels.push_back( level() );
+  level& l = levels.back();
+  l.point = point;
+  l.orbit.push_back( point );
+  l.trans.resize( b );   l.trans[point]  = row(b);
+  l.itrans.resize( b );  l.itrans[point] = row(b);
+}
+
+// Sift g down the chain, starting at level from.  On return, g is the
+// residue and the level at which sifting failed is returned.  If
+// sifting succeeded, depth() is returned and g is rounds iff it was in
+// the group.
+size_t stabilizer_chain::sift( row& g, size_t from ) const
+{
+  for ( size_t i = from; i < levels.size(); ++i ) {
+    level const& l = levels[i];
+    bell const x = g[ l.point ];
+    if ( x == l.point ) continue;
+    if ( l.trans[x].bells() == 0 ) return i;
+    g = l.itrans[x] * g;
+  }
+  return levels.size();
+}
+
+// Add g as a strong generator at levels from to to inclusive.  g
+// must fix the first to base points.  (It is not necessary to add it
+// to levels above from, as it is already known to be in the group
+// generated by the strong generators there.)
+void stabilizer_chain::add_generator( size_t from, size_t to, const row& g )
+{
+  if ( to == levels.size() ) {
+    // Use the first point moved by g as a new base point
+    bell p = 0;
+    while ( g[p] == p ) ++p;
+    add_level(p);
+  }
+
+  for ( size_t i = to + 1; i-- > from && !truncated; ) {
+    levels[i].gens.push_back(g);
+
+    // Apply the new generator to the existing orbit.  Any new points
+    // found are applied to all the generators by apply_generator.
+    size_t const n = levels[i].orbit.size(), gi = levels[i].gens.size() - 1;
+    for ( size_t j = 0; j < n && !truncated; ++j )
+      apply_generator( i, levels[i].orbit[j], gi );
+  }
+}
+
+// Consider the gi-th strong generator, s, at level i applied to the
+// orbit point p.
+void stabilizer_chain::apply_generator( size_t i, bell p, size_t gi )
+{
+  if ( truncated ) return;
+
+  row const s( levels[i].gens[gi] );
+  bell const q = s[p];
+  row h( s * levels[i].trans[p] );
+
+  if ( levels[i].trans[q].bells() == 0 ) {
+    // A new point in the orbit
+    levels[i].itrans[q] = h.inverse();
+    levels[i].trans[q].swap(h);
+    levels[i].orbit.push_back(q);
+
+    if ( bound && reached_bound() ) {
+      truncated = true;
+      return;
+    }
+
+    for ( size_t gj = 0; gj < levels[i].gens.size(); ++gj )
+      apply_generator( i, q, gj );
+  }
+  else {
+    // A Schreier generator
+    h = levels[i].itrans[q] * h;
+    size_t const lvl = sift( h, i+1 );
+    if ( lvl != levels.size() || !h.isrounds() )
+      add_generator( i+1, lvl, h );
+  }
+}
+
+RINGING_ULLONG stabilizer_chain::order() const
+{
+  RINGING_ULLONG o = 1;
+  for ( vector<level>::const_iterator i( levels.begin() ), e( levels.end() );
+        i != e; ++i ) {
+    RINGING_ULLONG const n = i->orbit.size();
+    if ( n > numeric_limits<RINGING_ULLONG>::max() / o )
+      throw overflow_error( "Group order is too large to represent" );
+    o *= n;
+  }
+  return o;
+}
+
+bool stabilizer_chain::contains( const row& r ) const
+{
+  // Rows on more bells are only members if they fix the extra bells
+  for ( size_t i = b; i < size_t(r.bells()); ++i )
+    if ( r[i] != bell(i) )
+      return false;
+
+  // Sift in place to avoid allocating a row at each level
+  vector<bell> g( b ), tmp( b );
+  for ( size_t i = 0; i < b; ++i )
+    g[i] = i < size_t(r.bells()) ? r[i] : bell(i);
+
+  for ( vector<level>::const_iterator i( levels.begin() ), e( levels.end() );
+        i != e; ++i ) {
+    bell const x = g[ i->point ];
+    if ( x == i->point ) continue;
+
+    row const& u = i->itrans[x];
+    if ( u.bells() == 0 ) return false;
+    for ( size_t j = 0; j < b; ++j )
+      tmp[j] = u[ g[j] ];
+    g.swap(tmp);
+  }
+
+  for ( size_t i = 0; i < b; ++i )
+    if ( g[i] != bell(i) )
+      return false;
+  return true;
+}
+
+row stabilizer_chain::random_element() const
+{
+  // Every element is uniquely a product of one transversal element
+  // from each level, so choosing each uniformly gives a uniform element.
+  row r(b);
+  for ( vector<level>::const_iterator i( levels.begin() ), e( levels.end() );
+        i != e; ++i )
+    if ( i->orbit.size() > 1 )
+      r *= i->trans[ i->orbit[ random_int( i->orbit.size() ) ] ];
+  return r;
+}
+
+vector<row> stabilizer_chain::stabilizer_generators( size_t i ) const
+{
+  return i < levels.size() ? levels[i].gens : vector<row>();
+}
+
+void stabilizer_chain::swap( stabilizer_chain& other )
+{
+  RINGING_PREFIX_STD swap( b, other.b );
+  gens.swap( other.gens );
+  levels.swap( other.levels );
+  RINGING_PREFIX_STD swap( bound, other.bound );
+  RINGING_PREFIX_STD swap( truncated, other.truncated );
+}
+
+stabilizer_chain::const_iterator stabilizer_chain::begin() const
+{
+  return const_iterator( this, 0, 0 );
+}
+
+stabilizer_chain::const_iterator stabilizer_chain::end() const
+{
+  return const_iterator();
+}
+
+size_t stabilizer_chain::branches() const
+{
+  // The length of the first non-trivial orbit
+  for ( size_t i = 0; i < levels.size(); ++i )
+    if ( levels[i].orbit.size() > 1 )
+      return levels[i].orbit.size();
+  return 1;
+}
+
+stabilizer_chain::const_iterator 
+stabilizer_chain::begin_branch( size_t i ) const
+{
+  return const_iterator( this, i, 1 );
+}
+
+// If stop is 1, only the elements with the given choice at the first
+// non-trivial level are enumerated.
+stabilizer_chain::const_iterator::const_iterator( const stabilizer_chain* c,
+                                                  size_t branch, size_t stop )
+  : c(c), stop(stop)
+{
+  for ( size_t i = 0; i < c->levels.size(); ++i )
+    if ( c->levels[i].orbit.size() > 1 )
+      lvls.push_back(i);
+
+  images.resize( lvls.size() );
+  idx.resize( lvls.size() );
+  prefix.resize( lvls.size() + 1 );
+  prefix[0] = row( c->b );
+  descend(0);
+
+  if ( this->stop > lvls.size() ) 
+    this->stop = lvls.size();
+  if ( this->stop && branch ) {
+    level const& l = c->levels[ lvls[0] ];
+    prefix[1] = prefix[0] * l.trans[ images[0][ idx[0] = branch ] ];
+    descend(1);
+  }
+}
+
+RINGING_START_ANON_NAMESPACE
+
+struct image_cmp {
+  explicit image_cmp( const row& r ) : r(r) {}
+  bool operator()( bell x, bell y ) const { return r[x] < r[y]; }
+  const row& r;
+};
+
+RINGING_END_ANON_NAMESPACE
+
+// Move to the first element below level k, given that prefix[k] is set.
+// The orbit at each level is visited in increasing order of its image
+// under the product of the transversal elements above it.  If the base
+// points are 0, 1, 2, ..., that product determines the leading bells
+// of the row, and so this gives lexicographical order.
+void stabilizer_chain::const_iterator::descend( size_t k )
+{
+  for ( ; k < lvls.size(); ++k ) {
+    level const& l = c->levels[ lvls[k] ];
+    images[k] = l.orbit;
+    sort( images[k].begin(), images[k].end(), image_cmp( prefix[k] ) );
+    idx[k] = 0;
+    prefix[k+1] = prefix[k] * l.trans[ images[k][0] ];
+  }
+}
+
+stabilizer_chain::const_iterator&
+stabilizer_chain::const_iterator::operator++()
+{
+  size_t k = lvls.size();
+  while ( k > stop && idx[k-1] + 1 == images[k-1].size() )
+    --k;
+
+  if ( k == stop ) {
+    // The end iterator
+    c = 0;
+    lvls.clear(); images.clear(); idx.clear(); prefix.clear();
+    return *this;
+  }
+
+  --k;
+  level const& l = c->levels[ lvls[k] ];
+  prefix[k+1] = prefix[k] * l.trans[ images[k][ ++idx[k] ] ];
+  descend( k+1 );
+  return *this;
+}
+
+RINGING_END_NAMESPACE
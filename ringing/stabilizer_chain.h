@@ -0,0 +1,192 @@
+// -*- C++ -*- stabilizer_chain.h - Base and strong generating set for a group
+// Copyright (C) 2014 Richard Smith <richard@ex-parrot.com>
+
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+// $Id$
+
+#ifndef RINGING_STABILIZER_CHAIN_H
+#define RINGING_STABILIZER_CHAIN_H
+
+#include <ringing/common.h>
+
+#if RINGING_HAS_PRAGMA_ONCE
+#pragma once
+#endif
+
+#if RINGING_HAS_PRAGMA_INTERFACE
+#pragma interface
+#endif
+
+#include <ringing/row.h>
+#if RINGING_OLD_INCLUDES
+#include <vector.h>
+#include <iterator.h>
+#else
+#include <vector>
+#include <iterator>
+#endif
+
+RINGING_START_NAMESPACE
+
+RINGING_USING_STD
+
+// --------------------------------------------------------------
+//
+// A stabilizer chain (or base and strong generating set) for the
+// group generated by a set of rows, built using the Schreier-Sims
+// algorithm.  This allows the order of the group to be found and
+// membership to be tested in O(n^2) time without ever enumerating
+// the group's elements.
+//
+// Level i of the chain holds the orbit of the ith base point under
+// the pointwise stabilizer, G^(i), of the previous base points, together
+// with a transversal: for each point x in the orbit, an element of G^(i)
+// mapping the base point to x.  (Rows are regarded as permutations with
+// r[i] the image of i, so (a*b)[i] == a[b[i]].)
+//
+class RINGING_API stabilizer_chain
+{
+public:
+  // The chain for the trivial group on no bells
+  stabilizer_chain() : b(0), bound(0), truncated(false) {}
+
+  // The base starts with the points in base_prefix (in that order) and
+  // is extended as necessary.  If base_prefix is 0, 1, ..., n-1, the
+  // elements are enumerated in lexicographical order.
+  //
+  // If order_bound is non-zero, construction stops as soon as the group
+  // is known to have at least that order.  In that case, complete() 
+  // returns false, order() returns a lower bound on the order that is
+  // at least order_bound, and the chain should not otherwise be used.
+  explicit stabilizer_chain( const vector<row>& generators,
+                             const vector<bell>& base_prefix
+                               = vector<bell>(),
+                             RINGING_ULLONG order_bound = 0 );
+
+  size_t bells() const { return b; }
+  bool complete() const { return !truncated; }
+
+  // A generating set for the group.  These are those of the generators 
+  // originally supplied that were not in the group generated by the 
+  // previous ones, padded to bells().
+  const vector<row>& generators() const { return gens; }
+
+  // The order of the group.  Throws overflow_error if it won't fit.
+  RINGING_ULLONG order() const;
+
+  // Is r a member of the group?
+  bool contains( const row& r ) const;
+
+  // A uniformly distributed random element of the group
+  row random_element() const;
+
+  // Access to the individual levels of the chain
+  size_t depth() const { return levels.size(); }
+  bell base_point( size_t i ) const { return levels[i].point; }
+  const vector<bell>& orbit( size_t i ) const { return levels[i].orbit; }
+
+  // An element of G^(i) taking base_point(i) to x, or an empty row
+  // if x is not in the orbit.
+  const row& transversal( size_t i, bell x ) const
+    { return levels[i].trans[x]; }
+
+  // A generating set for G^(i), the pointwise stabilizer of the
+  // first i base points.
+  vector<row> stabilizer_generators( size_t i ) const;
+
+  // Lazy enumeration of the elements of the group
+  class const_iterator;
+  const_iterator begin() const;
+  const_iterator end() const;
+
+  // The elements can also be enumerated in branches() separate, equally
+  // sized parts, which can be done concurrently.  Enumerating the parts
+  // in order gives the same order as begin() and end().
+  size_t branches() const;
+  const_iterator begin_branch( size_t i ) const;
+
+  void swap( stabilizer_chain& other );
+
+private:
+  struct level
+  {
+    bell point;           // The base point
+    vector<row> gens;     // Strong generators of G^(i)
+    vector<bell> orbit;   // The orbit of point under G^(i)
+    vector<row> trans;    // trans[x] takes point to x; empty if x not in orbit
+    vector<row> itrans;   // The inverses of the above
+  };
+
+  bool reached_bound() const;
+  void add_level( bell point );
+  void add_generator( size_t from, size_t to, const row& g );
+  void apply_generator( size_t i, bell p, size_t gi );
+  size_t sift( row& g, size_t from ) const;
+
+  size_t b;
+  vector<row> gens;
+  vector<level> levels;
+  RINGING_ULLONG bound;
+  bool truncated;
+};
+
+class RINGING_API stabilizer_chain::const_iterator
+  : public RINGING_STD_CONST_ITERATOR( forward_iterator_tag, row )
+{
+public:
+  // Standard iterator typedefs
+  typedef forward_iterator_tag iterator_category;
+  typedef row value_type;
+  typedef ptrdiff_t difference_type;
+  typedef const row *pointer;
+  typedef const row &reference;
+
+  const_iterator() : c(0) {}
+
+  // Trivial Iterator implementation
+  const row *operator->() const { return &prefix.back(); }
+  const row &operator*() const { return prefix.back(); }
+
+  // Equality Comparable implementation
+  bool operator==( const const_iterator &i ) const
+    { return c == i.c && (!c || prefix.back() == i.prefix.back()); }
+  bool operator!=( const const_iterator &i ) const
+    { return !( *this == i ); }
+
+  // Forward Iterator implementation
+  const_iterator &operator++();
+  const_iterator operator++(int)
+    { const_iterator tmp(*this); ++*this; return tmp; }
+
+private:
+  friend class stabilizer_chain;
+  const_iterator( const stabilizer_chain* c, size_t branch, size_t stop );
+
+  void descend( size_t from );
+
+  const stabilizer_chain* c;
+  size_t stop;                       // Levels above this are not advanced
+  vector<size_t> lvls;               // The levels with non-trivial orbits
+  vector< vector<bell> > images;     // The orbit at each level, sorted
+  vector<size_t> idx;                // Current position in images
+  vector<row> prefix;                // prefix[k] is the product above k
+};
+
+RINGING_END_NAMESPACE
+
+RINGING_DELEGATE_STD_SWAP( stabilizer_chain )
+
+#endif // RINGING_STABILIZER_CHAIN_H
@@ -27,8 +27,12 @@
 #if RINGING_OLD_INCLUDES
 #include <vector.h>
 #include <bvector.h>
+#include <list.h>
+#include <algo.h>
 #else
 #include <vector>
+#include <list>
+#include <algorithm>
 #endif
 #include <ringing/search_base.h>
 #include <ringing/table_search.h>
@@ -37,6 +41,7 @@
 #include <ringing/extent.h>
 #include <ringing/touch.h>
 #include <ringing/group.h>
+#include <ringing/parallel.h>
 
 #define DEBUG_LEVEL 0
 
@@ -69,10 +74,59 @@ static pair<size_t, size_t>
   return leads;
 }
 
+// Extend the partial permutation img, in which img[i] == -1 if i has not
+// been mapped, by mapping a to v and then whatever else is forced by 
+// img commuting with each of the changes.  Returns false if that is
+// impossible.
+static bool extend_commuting( vector<int> &img, vector<bool> &used,
+                              const vector<change> &changes, bell a, bell v )
+{
+  vector< pair<bell, bell> > todo( 1, make_pair(a, v) );
+  while ( !todo.empty() ) {
+    a = todo.back().first;  v = todo.back().second;  todo.pop_back();
+    if ( img[a] == v ) 
+      continue;
+    if ( img[a] != -1 || used[v] ) 
+      return false;
+    img[a] = v;  used[v] = true;
+    for ( vector<change>::const_iterator i( changes.begin() ); 
+          i != changes.end(); ++i )
+      todo.push_back( make_pair( a * *i, v * *i ) );
+  }
+  return true;
+}
+
+// Find the rows on b bells that commute with each of the changes.  Such 
+// a row is determined by where it maps the treble if the changes 
+// generate a transitive group, as they do for any sensible method, and 
+// nothing is found if they do not.
+static vector<row> find_commuting( const vector<change> &changes, int b )
+{
+  vector<row> rows;
+  for ( int v = 0; v < b; ++v ) {
+    vector<int> img( b, -1 );  vector<bool> used( b, false );
+    if ( extend_commuting( img, used, changes, 0, v ) 
+         && find( img.begin(), img.end(), -1 ) == img.end() )
+      rows.push_back( row( vector<bell>( img.begin(), img.end() ) ) );
+  }
+  return rows;
+}
+
+static bool normalises( const group &g, const row &r )
+{
+  row const ri( r.inverse() );
+  for ( vector<row>::const_iterator i( g.generators().begin() ),
+          e( g.generators().end() ); i != e; ++i )
+    if ( !g.contains( ri * *i * r ) )
+      return false;
+  return true;
+}
+
 table_search::table_search( const method &meth, const vector<change> &calls,
 			    const group& partends, flags f )
   : meth( meth ), calls( calls ), partends( partends ),
-    lenrange( make_pair( size_t(0), size_t(-1) ) ),  f(f)
+    lenrange( make_pair( size_t(0), size_t(-1) ) ),  f(f), task_depth(0),
+    shared_table(0), use_music( false ), best( 0 ), min_score( 0 )
 {}
 
 table_search::table_search( const method &meth, const vector<change> &calls,
@@ -81,7 +135,8 @@ table_search::table_search( const method &meth, const vector<change> &calls,
   : meth( meth ), calls( calls ), partends( partends ),
     lenrange( range_div( lenrange, f & length_in_changes
                                      ? partends.size() * meth.length() : 1) ),
-    f( f )
+    f( f ), task_depth( 0 ), shared_table( 0 ), use_music( false ), 
+    best( 0 ), min_score( 0 )
 {
   DEBUG( "Length range set to " << lenrange.first << "-" << lenrange.second 
          << " leads" );
@@ -90,7 +145,8 @@ table_search::table_search( const method &meth, const vector<change> &calls,
 table_search::table_search( const method &meth, const vector<change> &calls,
                             bool set_nr )
   : meth( meth ), calls( calls ),
-    f( set_nr ? ignore_rotations : no_flags )
+    f( set_nr ? ignore_rotations : no_flags ), task_depth( 0 ), 
+    shared_table( 0 ), use_music( false ), best( 0 ), min_score( 0 )
 {}
 
 table_search::table_search( const method &meth, const vector<change> &calls,
@@ -98,19 +154,31 @@ table_search::table_search( const method &meth, const vector<change> &calls,
   : meth( meth ), calls( calls ),
     lenrange( range_div( lenrange, f & length_in_changes
                                      ? partends.size() * meth.length() : 1) ),
-    f( set_nr ? ignore_rotations : no_flags )
+    f( set_nr ? ignore_rotations : no_flags ), task_depth( 0 ), 
+    shared_table( 0 ), use_music( false ), best( 0 ), min_score( 0 )
 {
   DEBUG( "Length range set to " << lenrange.first << "-" << lenrange.second 
          << " leads" );
 }
 
-class table_search::context : public search_base::context_base
+void table_search::set_music( const music &m, size_t b, int s )
+{
+  mus = m;  use_music = true;  best = b;  min_score = s;
+}
+
+class table_search::context : public search_base::context_base,
+                              private search_base::call_sequence::builder
 {
 public:
   context( const table_search *s ) 
-    : lenrange( s->lenrange ),  impossible( false ),
-      table( make_table( s ) ),
-      f( s->f )
+    : lenrange( s->lenrange ), task_depth( s->task_depth ),
+      impossible( false ),
+      own_table( s->shared_table ? multtab() : make_table( s ) ),
+      table( s->shared_table ? get_shared_table( s ) : own_table ),
+      f( s->f ),
+      range_first( s->get_range_first() ), range_last( s->get_range_last() ),
+      scoring( s->use_music ), best_lead( 0 ), best( s->best ), 
+      min_score( s->min_score ), meter( *s )
   {
     DEBUG( "Constructing context: table size " << table.size() );
 
@@ -135,6 +203,9 @@ public:
            | (!is_in_course(s)   ? 0 : falseness_table::in_course_only ) );
 
     DEBUG( "Initialised " << falsenesses.size() << " flhs" );
+
+    init_scores( s );
+    init_symmetries( s );
   }
 
 private:
@@ -175,16 +246,33 @@ private:
   {
     if ( is_fixed_treble(s) ) {
       DEBUG( "Fixed treble" );
-      return multtab( extent_iterator( s->meth.bells() - 1, 1),
-		      extent_iterator(), s->partends );
+      return multtab( extent( s->meth.bells() - 1, 1 ), s->partends );
     }
     else {
       DEBUG( "No fixed treble" );
-      return multtab( extent_iterator( s->meth.bells() ),
-		      extent_iterator(), s->partends );
+      return multtab( extent( s->meth.bells() ), s->partends );
    }
   }
 
+  // The table passed to set_table, replaced if it has the wrong rows
+  static multtab& get_shared_table( const table_search *s )
+  {
+    multtab &t = *s->shared_table;
+    int const b = s->meth.bells();
+    size_t const n = is_fixed_treble(s) ? extent( b - 1, 1 ).size() 
+                                        : extent( b ).size();
+
+    if ( t.bells() != b || t.partends() != s->partends 
+         || t.size() * s->partends.size() != n ) {
+      DEBUG( "Replacing shared table" );
+      make_table( s ).swap( t );
+    }
+    else if ( t.columns() > t.size() ) 
+      t.clear_columns();
+
+    return t;
+  }
+
   void init_falseness( const method &meth, int ft_flags )
   {
     falseness_table ft( meth, ft_flags );
@@ -204,6 +292,119 @@ private:
       DEBUG( "FLH: " << *i );
       falsenesses.push_back( table.compute_post_mult( *i ) );
     }
+
+    // Flatten the falseness columns of the table, if it is small enough
+    size_t const n = falsenesses.size();
+    if ( table.size() && table.size() <= max_flat_rows
+         && table.size() * n <= max_flat_size ) {
+      false_rows.resize( table.size() * n );
+      vector< false_row_t >::iterator fr( false_rows.begin() );
+      for ( size_t i = 0; i < table.size(); ++i ) {
+        row_t const r( row_t::from_index(i) );
+        for ( size_t j = 0; j < n; ++j )
+          *fr++ = false_row_t( (r * falsenesses[j]).index() );
+      }
+    }
+  }
+
+  // Score the lead starting at each lead head in every part
+  void init_scores( const table_search *s )
+  {
+    if ( !scoring ) return;
+
+    music m( s->mus );
+    vector< row > rows( s->meth.size() );
+    lead_scores.resize( table.size() );
+    for ( size_t i = 0; i < table.size(); ++i ) {
+      row const lh( table.find( row_t::from_index(i) ) );
+      for ( group::const_iterator p( table.partends().begin() ); 
+            p != table.partends().end(); ++p ) {
+        rows[0] = *p * lh;
+        for ( size_t j = 1; j < rows.size(); ++j )
+          rows[j] = rows[j-1] * s->meth[j-1];
+        m.process_rows( rows.begin(), rows.end() );
+        lead_scores[i] += m.get_score();
+      }
+    }
+
+    if ( !lead_scores.empty() )
+      best_lead = *max_element( lead_scores.begin(), lead_scores.end() );
+    DEBUG( "The best lead scores " << best_lead );
+  }
+
+  // Work out which symmetries of the search tree can be pruned
+  void init_symmetries( const table_search *s )
+  {
+    bool const multipart = table.partends().size() > 1;
+    int const b = table.bells();
+    bool const fixed_treble = is_fixed_treble(s);
+
+    vector<change> lead_ends( 1, s->meth.back() );
+    lead_ends.insert( lead_ends.end(), s->calls.begin(), s->calls.end() );
+
+    // Rotations are always pruned from single part searches, and 
+    // rotated touches output afterwards unless ignore_rotations is set,
+    // except when scoring touches, as the rotations score differently.
+    rotations = !multipart && !scoring || (f & ignore_rotations);
+    output_rotations = !multipart && !scoring && !(f & ignore_rotations);
+    if ( multipart && rotations ) {
+      normal.resize( table.size() );
+      for ( size_t i = 0; i < table.size(); ++i )
+        normal[i] = normalises( table.partends(), 
+                                table.find( row_t::from_index(i) ) );
+    }
+
+    // The reverse of a touch of a palindromic method is the touch with
+    // its calls reversed, premultiplied by the lead end.
+    reversals = false;
+    if ( (f & ignore_reversals) && !(f & non_round_blocks) ) {
+      size_t const n = s->meth.size();
+      reversals = true;
+      for ( size_t i = 0; reversals && i+1 < n; ++i )
+        if ( s->meth[i] != s->meth[n-2-i] )
+          reversals = false;
+
+      row le(b);
+      for ( size_t i = 0; i+1 < n; ++i ) le *= s->meth[i];
+      if ( reversals && ( (fixed_treble && le[0] != 0) 
+                          || !normalises( table.partends(), le ) ) )
+        reversals = false;
+    }
+
+    // Each conjugating row maps the calls onto themselves by a 
+    // permutation, the first of which is the identity.
+    perms.assign( 1, vector<size_t>() );
+    for ( size_t i = 0; i < lead_ends.size(); ++i ) 
+      perms[0].push_back(i);
+
+    if ( f & ignore_conjugates ) {
+      vector<change> changes( s->meth.begin(), s->meth.end()-1 );
+      vector<row> const rows( find_commuting( changes, b ) );
+
+      for ( vector<row>::const_iterator g( rows.begin() ); g != rows.end(); 
+            ++g ) {
+        if ( fixed_treble && (*g)[0] != 0 
+             || !normalises( table.partends(), *g ) )
+          continue;
+
+        vector<size_t> p;
+        for ( size_t i = 0; i < lead_ends.size(); ++i ) {
+          row const c( g->inverse() * ( row(b) * lead_ends[i] ) * *g );
+          size_t j = 0;
+          while ( j < lead_ends.size() && row(b) * lead_ends[j] != c ) ++j;
+          if ( j == lead_ends.size() ) break;
+          p.push_back(j);
+        }
+
+        if ( p.size() == lead_ends.size() 
+             && find( perms.begin(), perms.end(), p ) == perms.end() )
+          perms.push_back(p);
+      }
+    }
+
+    symmetric = reversals || perms.size() > 1 || (multipart && rotations);
+    DEBUG( "Pruning " << perms.size() - 1 << " conjugates" 
+           << (reversals ? " and reversals" : "") );
   }
 
   void init_call( const row &le, const change &ch )
@@ -217,27 +418,363 @@ private:
     cl->push_back( 1, c );
     c->push_back( ch );
     
-    call_lhs.push_back( table.compute_post_mult( le * ch ) );
+    call_rows.push_back( le * ch );
+    call_lhs.push_back( table.compute_post_mult( call_rows.back() ) );
   }
   
+  // Logically this is a vector<bool>, but the C++ standard mandates 
+  // that that should be a packed structure.  Changing to vector<char>
+  // makes a small but significant speed improvement.
+  typedef vector<char> lead_vector_t; 
+
+  // A touch that has been found but not yet output
+  struct found_touch
+  {
+    found_touch( const vector<size_t> &calls, size_t cur, int score )
+      : calls( calls ), cur( cur ), score( score ) {}
+
+    vector< size_t > calls;
+    size_t cur;
+    int score;
+  };
+
+  // A touch kept when scoring touches
+  struct scored_touch
+  {
+    scored_touch( const vector<size_t> &calls, unsigned parts, int score )
+      : calls( calls ), parts( parts ), score( score ) {}
+
+    // Is this a better touch than o?
+    bool operator<( const scored_touch &o ) const
+      { return score > o.score || score == o.score && calls < o.calls; }
+
+    vector< size_t > calls;
+    unsigned parts;
+    int score;
+  };
+
+  // When searching in parallel, the tree is split into tasks.  Each is 
+  // either the range of the tree below a sequence of calls or, if search
+  // is false, touches that were found while splitting the tree.
+  struct task
+  {
+    task() : search( false ), done( false ) {}
+
+    position start, end;		// The range to search
+    bool search;			// Is there a range to search?
+    bool done;				// Has the task finished?
+    vector< found_touch > touches;	// Touches waiting to be output
+  };
+
+  // A symmetry under which a prefix of the touch is so far equal to 
+  // its image: the touch rotated to begin at lead start, with its calls
+  // permuted by perms[perm].
+  struct candidate
+  {
+    candidate( size_t start, size_t perm ) : start( start ), perm( perm ) {}
+
+    size_t start, perm;
+  };
+
+  // The state of a depth-first search through all or part of the tree.
+  // Each thread has its own.
+  struct worker
+  {
+    explicit worker( size_t n ) 
+      : leads( n, false ), halt( false ), 
+        buffer( 0 ), tasks( 0 ), split_depth( size_t(-1) ), nodes( 0ul ),
+        score( 0 ), floor( 0 )
+    {}
+
+    lead_vector_t leads;		// The leads had so far
+    vector< size_t > calls;		// The calls we've had so far
+    bool halt;				// Are we terminating the search?
+    position start, end;		// The range to search
+    vector< found_touch > *buffer;	// If set, hold touches here
+    vector< task > *tasks;		// If set, split the tree into these
+    size_t split_depth;			// ... at this depth
+    RINGING_ULLONG nodes;               // Node count
+    statistics stats;			// Counts since last merged into meter
+    statistics uncounted;		// Counts that are discarded
+
+    // Used when scoring touches
+    int score;				// The score of the leads so far
+    int floor;				// The least score worth finding
+
+    // Used when pruning symmetries other than plain rotations
+    vector< char > normal;		// Whether each lead head normalises
+    vector< vector< candidate > > active;  // Candidates at each depth
+    vector< size_t > reversed;		// Scratch space
+  };
+
+  // Runs each task by calling context::run_task
+  class task_runner;
+  friend class task_runner;
+  class task_runner : public parallel_task
+  {
+  public:
+    task_runner( context &c, vector< task > &tasks, bool in_order )
+      : c( c ), tasks( tasks ), in_order( in_order ) {}
+
+    virtual void run( size_t i ) { c.run_task( tasks, i, in_order ); }
+
+  private:
+    context &c;
+    vector< task > &tasks;
+    bool in_order;
+  };
+
+  // The largest table for which false_rows is used, and the most entries
+  // it may have, which take 256MB
+  static size_t const max_flat_rows = size_t(1) << 31;
+  static size_t const max_flat_size = size_t(1) << 26;
+
+  // How often a thread checks whether another has halted the search,
+  // and how often the outputer is given a checkpoint
+  static size_t const poll_interval = 4096;
+  static size_t const checkpoint_interval = 1 << 20;
+
+  // The number of random paths used to estimate the size of the tree
+  static size_t const estimate_probes = 10000;
+
+  virtual bool supports_ranges() const { return true; }
+
   // Keep looking for touches, pushing them down the outputer.
   virtual void run( outputer &output ) 
   {
     // We might have already determined that the search cannot find anything
     // If so, we need to abort because the search may otherwise fail (i.e.
     // list false touches).
+    out = &output;  halted = false;  parallel = false;
+    start_scoring();
+    start_meter();
     if ( !impossible ) {
-      force_halt = false;
-      nodes = 0ul;
-      lead_vector_t( table.size(), false ).swap( leads );
-      run_recursive( output, row_t(), 0, 0 );
-      DEBUG( "Searched " << nodes << " nodes" );
+      worker w( table.size() );
+      w.start = range_first;  w.end = range_last;  w.floor = floor;
+      run_recursive( w, row_t(), 0, 0, true, !w.end.empty() );
+      DEBUG( "Searched " << w.nodes << " nodes" );
+      merge( w );
+      output_kept();
+    }
+    meter.report( *out );
+  }
+
+  // Split the tree into tasks at the task depth, and hand them out to
+  // the threads as they become free.  
+  virtual void run( outputer &output, unsigned threads, bool in_order )
+  {
+    if ( !threads ) threads = default_thread_count();
+
+    out = &output;  halted = false;  parallel = true;
+    start_scoring();
+    start_meter();
+    if ( impossible ) {
+      meter.report( *out );
+      return;
+    }
+
+    vector< task > tasks;
+    {
+      worker w( table.size() );
+      w.start = range_first;  w.end = range_last;  w.floor = floor;
+      w.tasks = &tasks;
+      w.split_depth = task_depth ? task_depth : default_task_depth(threads);
+      run_recursive( w, row_t(), 0, 0, true, !w.end.empty() );
+      merge( w );
+    }
+    DEBUG( "Split the search into " << tasks.size() << " tasks" );
+
+    next_task = 0;
+    task_runner r( *this, tasks, in_order );
+    run_parallel( r, tasks.size(), threads );
+
+    for ( list< worker >::iterator i( workers.begin() ); 
+          i != workers.end(); ++i )
+      merge( *i );
+    output_kept();
+    meter.report( *out );
+    workers.clear();  idle.clear();
+  }
+
+  void start_scoring()
+  {
+    kept.clear();
+    floor = min_score;
+  }
+
+  // Output the touches kept when scoring, best first
+  void output_kept()
+  {
+    sort( kept.begin(), kept.end() );
+    for ( vector< scored_touch >::const_iterator i( kept.begin() ); 
+          !halted && i != kept.end(); ++i ) {
+      size_t const *const first = i->calls.empty() ? 0 : &i->calls[0];
+      halted = (*out)( call_sequence( first, first + i->calls.size(), 
+                                      i->parts, *this, i->score ) );
+      ++meter.stats.touches;
+    }
+    vector< scored_touch >().swap( kept );
+  }
+
+  void start_meter()
+  {
+    meter.start();
+    if ( meter.enabled() && !impossible )
+      meter.stats.estimated_nodes = estimate_nodes();
+  }
+
+  // Add the worker's counts since it was last merged to the totals.  
+  // In a parallel search, the output lock must be held.
+  void merge( worker &w )
+  {
+    meter.stats += w.stats;
+
+    w.stats.nodes = w.stats.false_nodes = w.stats.non_canonical 
+      = w.stats.too_long = w.stats.bounded = 0;
+    fill( w.stats.depths.begin(), w.stats.depths.end(), 0 );
+  }
+
+  // Knuth's estimate of the size of the tree, ignoring any range: 
+  // follow random paths down from the root, and average the number 
+  // of nodes there would be if every node at each depth were like the
+  // one on the path.
+  double estimate_nodes()
+  {
+    worker w( table.size() );
+    vector< row_t > path;
+    unsigned long seed = 1;
+    double total = 0;
+
+    for ( size_t p = 0; p < estimate_probes; ++p ) {
+      row_t r;  size_t cur = 0;  double width = 1;
+      for ( size_t depth = 0; ; ++depth ) {
+        total += width;
+        if ( !( symmetric ? is_possibly_canonical( w, depth ) 
+                          : is_possibly_canonical( w.calls, cur ) ) 
+             || is_row_false( w.leads, r ) || depth >= lenrange.second )
+          break;
+
+        w.leads[r.index()] = true;  path.push_back(r);
+        if ( symmetric ) 
+          w.normal.push_back( normal.empty() || normal[r.index()] );
+
+        seed = seed * 1103515245ul + 12345ul;
+        w.calls.push_back( (seed >> 16) % call_lhs.size() );
+        width *= call_lhs.size();
+        r = r * call_lhs[ w.calls.back() ];
+      }
+
+      for ( vector< row_t >::const_iterator i( path.begin() ); 
+            i != path.end(); ++i )
+        w.leads[i->index()] = false;
+      path.clear();  w.calls.clear();  w.normal.clear();
     }
+
+    return total / estimate_probes;
+  }
+
+  // The smallest depth giving a few dozen tasks per thread, so that 
+  // the threads are kept busy even though subtrees vary greatly in size.
+  size_t default_task_depth( unsigned threads ) const
+  {
+    size_t depth = 1;
+    for ( size_t n = call_lhs.size(); 
+          call_lhs.size() > 1 && n < 64 * threads; n *= call_lhs.size() )
+      ++depth;
+    return depth;
+  }
+
+  void run_task( vector< task > &tasks, size_t i, bool in_order )
+  {
+    task &t = tasks[i];
+    if ( t.search && !is_halted() ) {
+      worker *w = acquire_worker();
+      w->start = t.start;  w->end = t.end;
+      w->buffer = in_order ? &t.touches : 0;
+      w->halt = false;
+      w->floor = current_floor();
+      run_recursive( *w, row_t(), 0, 0, true, true );
+      release_worker( w );
+    }
+
+    mutex::scoped_lock l( output_lock );
+    if ( meter.due() ) 
+      meter.report( *out );
+    if ( !in_order ) 
+      flush( t.touches );
+    else {
+      t.done = true;
+      size_t const n = next_task;
+      while ( next_task < tasks.size() && tasks[next_task].done )
+        flush( tasks[next_task++].touches );
+      if ( next_task != n && next_task < tasks.size() && !halted 
+           && !scoring )
+        out->checkpoint( tasks[next_task].start );
+    }
+  }
+
+  // Output a list of touches.  The output lock must be held.
+  void flush( vector< found_touch > &touches )
+  {
+    for ( vector< found_touch >::const_iterator i( touches.begin() ); 
+          !halted && i != touches.end(); ++i )
+      halted = output_touch( i->calls, i->cur, i->score );
+    vector< found_touch >().swap( touches );
+  }
+
+  bool is_halted()
+  {
+    mutex::scoped_lock l( output_lock );
+    return halted;
+  }
+
+  int current_floor()
+  {
+    mutex::scoped_lock l( output_lock );
+    return floor;
+  }
+
+  // Called periodically by each thread.  Returns true if the search 
+  // has been halted.
+  bool poll( worker &w )
+  {
+    mutex::scoped_lock l( output_lock );
+    merge( w );
+    if ( meter.due() ) 
+      meter.report( *out );
+    w.floor = floor;
+    return halted;
+  }
+
+  worker *acquire_worker()
+  {
+    mutex::scoped_lock l( worker_lock );
+    if ( idle.empty() ) {
+      workers.push_back( worker( table.size() ) );
+      return &workers.back();
+    }
+    worker *w = idle.back();  idle.pop_back();
+    return w;
+  }
+
+  void release_worker( worker *w )
+  {
+    mutex::scoped_lock l( worker_lock );
+    idle.push_back( w );
   }
 
   // Is the row false against a row that we've already had?
-  bool is_row_false( const row_t &r )
+  bool is_row_false( const lead_vector_t &leads, const row_t &r ) const
   {
+    if ( !false_rows.empty() ) {
+      size_t const n = falsenesses.size();
+      for ( const false_row_t *i = &false_rows[ r.index() * n ], *e = i + n; 
+            i != e; ++i )
+        if ( leads[*i] )
+          return true;
+      return false;
+    }
+
     for ( vector< post_col_t >::const_iterator i( falsenesses.begin() ); 
 	  i != falsenesses.end(); ++i )
       if ( leads[ (r * *i).index() ] )
@@ -246,35 +783,109 @@ private:
     return false;
   }
 
-  // Output the current touch and any rotations of it.
-  void output_touch( outputer &output, size_t cur )
+  // Deal with a touch that has been found: either output it, or keep 
+  // it to be output later.
+  void found( worker &w, size_t cur )
   {
-    size_t len( calls.size() );
-    list< touch_child_list::entry > &ch = tl->children();
+    if ( scoring && w.score < w.floor )
+      return;
 
-    ch.clear();
-    
+    if ( w.tasks ) {
+      if ( w.tasks->empty() || w.tasks->back().search ) {
+        w.tasks->push_back( task() );
+        w.tasks->back().start = w.calls;
+      }
+      w.tasks->back().touches.push_back
+        ( found_touch( w.calls, cur, w.score ) );
+    }
+    else if ( w.buffer )
+      w.buffer->push_back( found_touch( w.calls, cur, w.score ) );
+    else if ( !parallel ) {
+      w.halt = output_touch( w.calls, cur, w.score );
+      w.floor = floor;
+    }
+    else {
+      mutex::scoped_lock l( output_lock );
+      if ( !halted ) halted = output_touch( w.calls, cur, w.score );
+      w.halt = halted;
+      w.floor = floor;
+    }
+  }
+
+  // Output the touch and any rotations of it, or keep it if scoring.
+  // Returns true if the search should halt.
+  bool output_touch( const vector< size_t > &calls, size_t cur, int score )
+  {
+    size_t const len( calls.size() );
+
+    // The number of times the block is repeated to come round
+    row end( table.bells() );
     for ( size_t i=0; i < len; ++i )
-      tl->push_back( 1, t.get_node( 2 * (1 + calls[i]) ) );
+      end *= call_rows[ calls[i] ];
+    unsigned const parts( end.order() );
 
     // If we want more than mutually true blocks, make sure it is 
     // actually an n-part.
-    if ( !(f & mutually_true_parts) && table.partends().size() > 1 ) {
-      if ( for_each( t.begin(), t.end(), permute(table.bells()) ).get().order()
-             != table.partends().size() )
-        return;
+    if ( !(f & mutually_true_parts) && table.partends().size() > 1 
+         && parts != table.partends().size() )
+      return false;
+
+    if ( scoring ) {
+      keep( scored_touch( calls, parts, score ) );
+      return false;
     }
 
-    force_halt = output( t );
+    // The rotations are windows onto the calls repeated twice
+    rotated.assign( calls.begin(), calls.end() );
+    rotated.insert( rotated.end(), calls.begin(), calls.end() );
+    size_t const *const first = len ? &rotated[0] : 0;
+
+    bool force_halt = (*out)( call_sequence( first, first + len, parts, 
+                                             *this ) );
+    ++meter.stats.touches;
 
     // Try all of it's distinguishable rotations.
-    if ( !(f & ignore_rotations) && table.partends().size() == 1 ) {
-      size_t parts( len % cur ? cur : len / cur );
-      for ( size_t start = 1; !force_halt && start < len / parts; ++start ) {
-        ch.splice( ch.end(), ch, ch.begin() );
-        force_halt = output( t );
+    if ( output_rotations ) {
+      size_t period( len % cur ? cur : len / cur );
+      for ( size_t start = 1; !force_halt && start < len / period; ++start ) {
+        force_halt = (*out)( call_sequence( first + start, 
+                                            first + start + len, parts, 
+                                            *this ) );
+        ++meter.stats.touches;
       }
     }
+
+    return force_halt;
+  }
+
+  // Keep a scored touch if it is one of the best found so far.  The 
+  // kept touches are a heap with the worst at the front, and once there
+  // are enough of them, nothing worse than it need be found.  The output
+  // lock must be held.
+  void keep( const scored_touch &t )
+  {
+    if ( best && kept.size() == best ) {
+      if ( !( t < kept.front() ) )
+        return;
+      pop_heap( kept.begin(), kept.end() );
+      kept.back() = t;
+    }
+    else
+      kept.push_back( t );
+    push_heap( kept.begin(), kept.end() );
+
+    if ( best && kept.size() == best && kept.front().score > floor )
+      floor = kept.front().score;
+  }
+
+  // Build the touch for a call sequence when the outputer asks for it
+  virtual const touch &make_touch( const call_sequence &c )
+  {
+    list< touch_child_list::entry > &ch = tl->children();
+    ch.clear();
+    for ( call_sequence::const_iterator i( c.begin() ); i != c.end(); ++i )
+      tl->push_back( 1, t.get_node( 2 * (1 + *i) ) );
+    return t;
   }
 
   // A touch, T, is in canonical form if there exists no rotation of T
@@ -282,13 +893,14 @@ private:
 
   // This function returns true if the current fragment could possibly be
   // at the start of a canonical touch.
-  bool is_possibly_canonical( size_t &cur )
+  bool is_possibly_canonical( const vector< size_t > &calls, size_t &cur )
   {
     if ( calls.empty() )
       return true;
 
-    // Multipart comps are always canonical 
-    if ( table.partends().size() > 1 ) return true;
+    // Multipart comps are always canonical, as are those of scored 
+    // searches that do not ignore rotations
+    if ( !rotations ) return true;
 
     if ( cur == 0 || calls.back() > calls[ calls.size() - 1 - cur ] )
       cur = calls.size();
@@ -301,81 +913,304 @@ private:
 
   // ... and this function checks that a touch fragment for which 
   // is_possibly_canonical() returns true is a canonical complete touch.
-  bool is_really_canonical()
+  // The rotations that wrap round past the end of the touch have not 
+  // yet been compared in full.
+  bool is_really_canonical( const vector< size_t > &calls )
   {
-    // Multipart comps are always canonical (because we don't prue rotations
-    // from multi-part searches)
-    if ( table.partends().size() > 1 ) return true;
+    // Multipart comps are always canonical (because we don't prune 
+    // rotations from multi-part searches), as are scored ones
+    if ( !rotations ) return true;
 
-    for ( vector< size_t >::const_iterator i( calls.begin() ); 
-	  i != calls.end(); ++i )
-      if ( *i != calls.front() )
-	return calls.back() != calls.front();
+    size_t const n = calls.size();
+    for ( size_t j = 1; j < n; ++j )
+      for ( size_t i = 0; i < n; ++i ) {
+        size_t const c = calls[ (j + i) % n ];
+        if ( c < calls[i] ) return false;
+        if ( c > calls[i] ) break;
+      }
+    return true;
+  }
+
+  // When pruning symmetries other than rotations of single part 
+  // touches, a touch is in canonical form if no image of it under the
+  // symmetries is lexicographically less than it.  The candidates are the
+  // symmetries whose images are equal to the touch so far: if the latest 
+  // call makes an image less, the touch cannot be canonical, and if it 
+  // makes it greater, that image can be forgotten.  Reversals are only
+  // checked in is_canonical().
+  bool is_possibly_canonical( worker &w, size_t depth ) const
+  {
+    if ( depth == 0 ) return true;
+    if ( w.active.size() <= depth ) w.active.resize( depth + 1 );
+
+    vector< candidate > &a = w.active[depth];
+    a.clear();
+    if ( depth > 1 ) 
+      a = w.active[depth-1];
+
+    // Images beginning with the latest lead
+    size_t const j = depth - 1;
+    if ( j == 0 || rotations && w.normal[j] )
+      for ( size_t p = j == 0 ? 1 : 0; p < perms.size(); ++p )
+        a.push_back( candidate( j, p ) );
+
+    size_t const c = w.calls[j];
+    vector< candidate >::iterator o( a.begin() );
+    for ( vector< candidate >::const_iterator i( a.begin() ); 
+          i != a.end(); ++i ) {
+      size_t const im = perms[i->perm][c], t = w.calls[ j - i->start ];
+      if ( im < t ) 
+        return false;
+      else if ( im == t )
+        *o++ = *i;
+    }
+    a.erase( o, a.end() );
     return true;
   }
 
-  // The main loop of the algorithm   
-  void run_recursive( outputer &output, const row_t &r, 
-                      size_t depth, size_t cur )
+  // ... and this checks all of the images of a complete touch for 
+  // which is_possibly_canonical() returned true.
+  bool is_canonical( worker &w ) const
+  {
+    const vector< size_t > &t = w.calls;
+    size_t const n = t.size();
+
+    w.reversed.assign( t.rbegin(), t.rend() );
+    for ( int rev = 0; rev < (reversals ? 2 : 1); ++rev ) {
+      const vector< size_t > &s = rev ? w.reversed : t;
+      row_t r;
+      for ( size_t j = 0; j < n; r = r * call_lhs[ s[j++] ] ) {
+        if ( j && !( rotations && ( normal.empty() || normal[r.index()] ) ) )
+          continue;
+
+        for ( size_t p = 0; p < perms.size(); ++p ) {
+          const vector< size_t > &perm = perms[p];
+          for ( size_t i = 0; i < n; ++i ) {
+            size_t const im = perm[ s[ (j + i) % n ] ];
+            if ( im < t[i] ) return false;
+            if ( im > t[i] ) break;
+          }
+        }
+      }
+    }
+    return true;
+  }
+
+  // Is the best score of a touch below the node, if every lead to come 
+  // scored as much as the best lead, less than the score worth finding?
+  bool is_bounded( const worker &w, size_t depth ) const
+  {
+    double bound = w.score;
+    if ( best_lead > 0 )
+      bound += double( min( lenrange.second, table.size() ) - depth ) 
+                 * best_lead;
+    return bound < w.floor;
+  }
+
+  // The shortest period of a touch: the number of its distinct rotations
+  static size_t period( const vector< size_t > &calls )
+  {
+    size_t const n = calls.size();
+    for ( size_t p = 1; p < n; ++p )
+      if ( n % p == 0 && equal( calls.begin() + p, calls.end(), 
+                                calls.begin() ) )
+        return p;
+    return n;
+  }
+
+  // Add a task for the subtree below the current node, or the part of
+  // it within the range.
+  void split( worker &w, bool on_end )
+  {
+    w.tasks->push_back( task() );
+    task &t = w.tasks->back();
+    t.search = true;
+
+    t.start = max( w.calls, w.start );
+    t.end = w.calls;  ++t.end.back();
+    if ( on_end ) t.end = min( t.end, w.end );
+  }
+
+  // The main loop of the algorithm.  The node is on the path to the 
+  // start or end of the range being searched if on_start or on_end is
+  // set.
+  void run_recursive( worker &w, const row_t &r, size_t depth, size_t cur,
+                      bool on_start, bool on_end )
   {
 #if DEBUG_LEVEL > 1
-    IF_DEBUG( copy( calls.begin(), calls.end(), ostream_iterator<int>(cout) ));
+    IF_DEBUG( copy( w.calls.begin(), w.calls.end(), 
+                    ostream_iterator<int>(cout) ));
     DEBUG( " at depth " << depth );
 #endif
 
-    IF_DEBUG( (++nodes % 1000000 == 0) && (cout << "Node: " << nodes << "\n") );
+    IF_DEBUG( (w.nodes % 1000000 == 0) && (cout << "Node: " << w.nodes << "\n") );
+
+    // Have we reached the end of the range?
+    if ( on_end && depth == w.end.size() ) {
+      w.halt = true;
+      return;
+    }
+
+    // Nodes leading to the start of the range come before it
+    bool const before_start = on_start && depth < w.start.size();
+
+    if ( ++w.nodes % poll_interval == 0 ) {
+      // In a parallel search, check whether another thread has halted 
+      // the search; otherwise let the outputer record where we are.
+      if ( parallel ) 
+        w.halt = poll( w ) || w.halt;
+      else {
+        if ( w.nodes % checkpoint_interval == 0 && !before_start 
+             && !scoring )
+          out->checkpoint( w.calls );
+        if ( meter.due() ) {
+          merge( w );
+          meter.report( *out );
+        }
+      }
+    }
+
+    // Nodes on the way to the start of the range are counted by the 
+    // search of the part of the tree before it, and nodes where the tree
+    // is split by the task that searches below them.
+    statistics &st = before_start ? w.uncounted : w.stats;
+    ++st.nodes;
+    if ( depth >= st.depths.size() ) 
+      st.depths.resize( depth + 1 );
+    ++st.depths[depth];
 
     // Is the touch lexicographically no greater than any of it's rotations?
-    if ( !is_possibly_canonical( cur ) )
+    if ( symmetric ? !is_possibly_canonical( w, depth ) 
+                   : !is_possibly_canonical( w.calls, cur ) ) {
+      ++st.non_canonical;
       return;
+    }
 
     // Is the going to repeat?
-    else if ( is_row_false( r ) )
+    else if ( is_row_false( w.leads, r ) )
       {
+        ++st.false_nodes;
+
 	// Has it come round, and is it in it's canonical form?
-	if ( depth >= lenrange.first 
+	if ( depth >= lenrange.first && !before_start
              && ( (f & non_round_blocks) || r.isrounds() ) 
-             && is_really_canonical() )
-	  output_touch( output, cur );
+             && ( symmetric ? is_canonical( w ) 
+                            : is_really_canonical( w.calls ) ) )
+	  found( w, symmetric ? period( w.calls ) : cur );
       }
     else if ( depth < lenrange.second )
       {
-	leads[r.index()] = true;
-	calls.push_back( 0 );
+        // Could a touch below here score enough?
+        if ( scoring && is_bounded( w, depth ) ) {
+          ++st.bounded;
+          return;
+        }
+
+        // Leave the subtree to be searched as a separate task
+        if ( depth == w.split_depth ) {
+          --st.nodes;  --st.depths[depth];
+          split( w, on_end );
+          return;
+        }
+
+        // Skip the calls outside the range
+        size_t first = 0, last = call_lhs.size();
+        if ( before_start ) 
+          first = w.start[depth];
+        if ( on_end && w.end[depth] < last ) 
+          last = w.end[depth] + 1;
+
+	w.leads[r.index()] = true;
+        if ( symmetric ) 
+          w.normal.push_back( normal.empty() || normal[r.index()] );
+        if ( scoring )
+          w.score += lead_scores[r.index()];
+	w.calls.push_back( first );
 	
-	for ( ; !force_halt && calls.back() < call_lhs.size(); ++calls.back() )
+	for ( ; !w.halt && w.calls.back() < last; ++w.calls.back() )
 	  {
-	    run_recursive( output, r * call_lhs[ calls.back() ], 
-			   depth + 1, cur );
+	    size_t const c = w.calls.back();
+	    run_recursive( w, r * call_lhs[c], depth + 1, cur,
+			   before_start && c == w.start[depth],
+			   on_end && c == w.end[depth] );
 	  }
 	
-	calls.pop_back();
-	leads[r.index()] = false;
+	w.calls.pop_back();
+        if ( scoring )
+          w.score -= lead_scores[r.index()];
+        if ( symmetric ) 
+          w.normal.pop_back();
+	w.leads[r.index()] = false;
       }
+    else
+      ++st.too_long;
   }
  
 private:
   // Data members
   pair< size_t, size_t > lenrange;	// The min & max lengths (in leads)
-  bool force_halt;			// Are we terminating the search?
+  size_t task_depth;			// The depth at which to split
   bool impossible;                      // Whether the search cannot succeed
-  vector< size_t > calls;		// The calls we've had so far
   touch t;				// The current touch
   touch_child_list *tl;
-  multtab table;			// A precomputed multiplication table
+  multtab own_table;			// The table, unless one is shared
+  multtab &table;			// A precomputed multiplication table
   flags f;	                        // Are we to ignore rotations, etc.
-  RINGING_ULLONG nodes;                 // Node count
-
-  // Logically this is a vector<bool>, but the C++ standard mandates 
-  // that that should be a packed structure.  Changing to vector<char>
-  // makes a small but significant speed improvement.
-  typedef vector<char> lead_vector_t; 
 
-  lead_vector_t leads;			// The leads had so far
   vector< post_col_t > call_lhs;	// The effect of each call (inc. Pl.)
+  vector< row > call_rows;		// ... as the lead head it gives
   vector< post_col_t > falsenesses;	// The falsenesses of the method
+  position range_first, range_last;	// The range to search
+
+  // The symmetries being pruned, other than rotations of single part
+  // touches, which is_possibly_canonical( calls, cur ) handles
+  bool symmetric;			// Are there any?
+  bool rotations;			// Prune rotations?
+  bool output_rotations;		// ... and output them with the touch?
+  bool reversals;			// Prune reversals?
+  vector< char > normal;		// Which lead heads normalise the
+					// part ends (or empty if all do)
+  vector< vector< size_t > > perms;	// Permutations of the calls by
+					// conjugation, starting with 1
+
+  // When scoring touches by their music
+  bool scoring;				// Are touches being scored?
+  vector< int > lead_scores;		// The score of the lead at each
+					// lead head, in every part
+  int best_lead;			// The highest of those
+  size_t best;				// How many touches to keep, or 0
+  int min_score;			// The lowest score to keep
+
+  // The rows that each row is false against: those for the row with 
+  // index i are at [ i*n, (i+1)*n ), where n is falsenesses.size().  
+  // This avoids the double indirection of multtab and keeps the rows
+  // for one lead together in a single cache line or two.  It is left 
+  // empty if the table is too large.
+  typedef unsigned int false_row_t;
+  vector< false_row_t > false_rows;
+
+  // The state of the current run
+  outputer *out;
+  bool parallel;			// Are several threads searching?
+  mutex output_lock;			// Protects out, t and the following
+  bool halted;				// Are we terminating the search?
+  size_t next_task;			// The next task to output, in order
+  vector< size_t > rotated;		// The calls being output, twice
+  vector< scored_touch > kept;		// The best touches, as a heap
+  int floor;				// The least score worth finding
+  progress_meter meter;			// Statistics for the run
+
+  mutex worker_lock;			// Protects the following
+  list< worker > workers;		// The state for each thread
+  vector< worker * > idle;		// Workers not in use
 };
 
+size_t const table_search::context::max_flat_rows;
+size_t const table_search::context::max_flat_size;
+size_t const table_search::context::poll_interval;
+size_t const table_search::context::checkpoint_interval;
+size_t const table_search::context::estimate_probes;
+
 search_base::context_base *table_search::new_context() const 
 { 
   return new context( this );
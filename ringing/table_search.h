@@ -39,23 +39,30 @@
 #include <ringing/method.h>
 #include <ringing/search_base.h>
 #include <ringing/group.h>
+#include <ringing/music.h>
 
 RINGING_START_NAMESPACE
 
 RINGING_USING_STD
 
+class multtab;
+
 #if RINGING_AS_DLL
 RINGING_EXPLICIT_TEMPLATE 
 struct RINGING_API RINGING_PREFIX_STD pair<size_t, size_t>;
 #endif
 
+// Touches are passed to the outputer as call_sequences, with the calls
+// numbered from 1 in the order given to the constructor.
 class RINGING_API table_search : public search_base
 {
 public:
   enum flags {
     no_flags = 0x0,
 
-    // Prune rotations from the search
+    // Prune rotations from the search.  In multipart searches, only 
+    // those rotations starting at a lead head that normalises the part
+    // end group are pruned, as others do not have the same part ends.
     ignore_rotations = 0x01,  // == true
 
     // In multipart searches, allow blocks that do not all join together
@@ -67,7 +74,21 @@ public:
     length_in_changes = 0x04,
 
     // Allow non-round blocks.  Not compatible with ignore_rotations
-    non_round_blocks = 0x08
+    // or ignore_reversals
+    non_round_blocks = 0x08,
+
+    // Prune reversals from the search.  This only has an effect if the 
+    // method is palindromic apart from its lead end change, and if the
+    // lead end normalises the part end group.  
+    ignore_reversals = 0x10,
+
+    // Prune touches that are the conjugate, g^-1 T g, of another touch
+    // by a row g that commutes with the changes of the method other than
+    // the lead end, normalises the part end group, and maps the lead end
+    // changes and calls onto each other.  For a method with a hunt bell
+    // the only such row fixing the treble is rounds, so this is only of
+    // use with principles.
+    ignore_conjugates = 0x20
   };
 
   // Constructors
@@ -86,6 +107,40 @@ public:
                 pair< size_t, size_t > lenrange, 
                 bool set_ignore_rotations = false);
 
+  // When run with several threads, the search is split into a separate 
+  // task for the subtree below each sequence of this many leads.  If it
+  // is 0 (the default), a depth giving several dozen tasks per thread is
+  // chosen.
+  void set_task_depth( size_t depth ) { task_depth = depth; }
+
+  // Use t as the multiplication table, rather than building a new one
+  // for each run of the search.  If t does not have the rows of the 
+  // extent (or of the extent fixing the treble, if the method and calls
+  // do) factored by the part ends, it is replaced by a table that does.
+  // Products already computed in t are reused, so when the same table
+  // is used to search several methods on the same number of bells, 
+  // only the products specific to each method are computed.  They are
+  // discarded once there are more of them than rows in the table.  The
+  // table must not be used by anything else while the search runs.
+  void set_table( multtab &t ) { shared_table = &t; }
+
+  // Score each touch by its music, and rather than outputting touches as
+  // they are found, keep the best touches scoring at least min_score and
+  // output them, highest scoring first, when the search finishes.  If 
+  // best is 0, every touch scoring at least min_score is kept.  Equal 
+  // scores are ordered by their calls, so the same touches are output 
+  // however many threads are used.  Each lead is taken to start at
+  // handstroke.
+  //
+  // Branches of the search that cannot reach the score of the worst
+  // touch kept, once there are enough, or min_score are pruned using 
+  // the score of the best lead.  For this to be possible, rotations of
+  // single part touches are searched separately rather than being 
+  // output with the touch, unless ignore_rotations is set.  Only the 
+  // canonical touch is scored when other symmetries are ignored.  
+  // Touches are not checkpointed.
+  void set_music( const music &m, size_t best, int min_score );
+
 private:
   // The implementation
   class context;
@@ -98,6 +153,12 @@ private:
   group partends;
   pair< size_t, size_t > lenrange; // The minimum and maximum number of leads
   flags f;
+  size_t task_depth;
+  multtab *shared_table;
+  music mus;
+  bool use_music;
+  size_t best;     // How many touches to keep, or 0 for all
+  int min_score;
 };
 
 
@@ -25,8 +25,10 @@
 
 #if RINGING_OLD_INCLUDES
 #include <algo.h>
+#include <map.h>
 #else 
 #include <algorithm>
+#include <map>
 #endif
 #include <ringing/touch.h>
 
@@ -123,5 +125,139 @@ void touch::push_back( touch_node *node )
   nodes.push_back( shared_pointer<touch_node>( node ) ); 
 }
 
+// *********************************************************************
+// *                Functions for class compiled_touch                 *
+// *********************************************************************
+
+class compiled_touch::compiler {
+public:
+  compiler( compiled_touch &ct ) : ct(ct), barrier(0) {}
+
+  void add( const touch_node *tn, size_t reps );
+  void finish();
+
+private:
+  void add_run( size_t begin, size_t end, size_t reps );
+
+  compiled_touch &ct;
+  map< change, size_t > indices;
+  size_t barrier;  // Runs before this belong to an enclosing repeat
+};
+
+void compiled_touch::compiler::add( const touch_node *tn, size_t reps )
+{
+  if ( reps == 0 ) return;
+
+  size_t const first_seq = ct.seq.size(), first_run = ct.rs.size();
+  const touch_child_list *tl = dynamic_cast<const touch_child_list *>(tn);
+
+  if ( !tl ) {
+    for ( touch_node::const_iterator i( tn->begin() ), e( tn->end() ); 
+          i != e; ++i ) {
+      map< change, size_t >::const_iterator j
+        = indices.insert( make_pair( *i, ct.chs.size() ) ).first;
+      if ( j->second == ct.chs.size() ) ct.chs.push_back( *i );
+      ct.seq.push_back( j->second );
+    }
+    add_run( first_seq, ct.seq.size(), reps );
+    return;
+  }
+
+  size_t const old_barrier = barrier;
+  if ( reps > 1 ) barrier = first_run;
+  for ( list<touch_child_list::entry>::const_iterator 
+          i( tl->children().begin() ), e( tl->children().end() ); i != e; ++i )
+    if ( i->first > 0 )
+      add( i->second, i->first );
+  barrier = old_barrier;
+
+  if ( reps == 1 || ct.rs.size() == first_run ) 
+    return;
+
+  if ( ct.rs.size() == first_run + 1 ) {
+    ct.rs.back().reps *= reps;
+    return;
+  }
+
+  // Write out the runs of the child list so that it is one run
+  vector<size_t> s;
+  for ( vector<run>::const_iterator i( ct.rs.begin() + first_run ), 
+          e( ct.rs.end() ); i != e; ++i )
+    for ( size_t r = 0; r < i->reps; ++r )
+      s.insert( s.end(), ct.seq.begin() + i->begin, ct.seq.begin() + i->end );
+
+  ct.rs.erase( ct.rs.begin() + first_run, ct.rs.end() );
+  ct.seq.erase( ct.seq.begin() + first_seq, ct.seq.end() );
+  ct.seq.insert( ct.seq.end(), s.begin(), s.end() );
+  add_run( first_seq, ct.seq.size(), reps );
+}
+
+void compiled_touch::compiler::add_run( size_t begin, size_t end, 
+                                        size_t reps )
+{
+  if ( begin == end ) return;
+
+  // Merge it with the previous run if neither is repeated
+  if ( reps == 1 && ct.rs.size() > barrier && ct.rs.back().reps == 1 
+       && ct.rs.back().end == begin )
+    ct.rs.back().end = end;
+  else
+    ct.rs.push_back( run( begin, end, reps ) );
+}
+
+void compiled_touch::compiler::finish()
+{
+  for ( vector<change>::const_iterator i( ct.chs.begin() ), 
+          e( ct.chs.end() ); i != e; ++i )
+    ct.b = max( ct.b, i->bells() );
+
+  // The row reached by ringing the change from rounds has in position j
+  // the bell that was in the position moving to j
+  for ( vector<change>::const_iterator i( ct.chs.begin() ), 
+          e( ct.chs.end() ); i != e; ++i ) {
+    row r( ct.b );  r *= *i;
+    ct.perms.insert( ct.perms.end(), r.begin(), r.end() );
+  }
+
+  for ( vector<run>::const_iterator i( ct.rs.begin() ), e( ct.rs.end() ); 
+        i != e; ++i )
+    ct.n += ( i->end - i->begin ) * i->reps;
+}
+
+compiled_touch touch::compile() const
+{
+  compiled_touch ct;
+  if ( head ) {
+    compiled_touch::compiler c( ct );
+    c.add( head, 1 );
+    c.finish();
+  }
+  return ct;
+}
+
+row compiled_touch::rows( const row &start, row_matrix &m ) const
+{
+  if ( m.empty() ) m.b = b;
+  if ( n == 0 ) return start;
+
+  size_t const first = m.data.size();
+  m.data.resize( first + (n+1) * b );
+  copy( start.begin(), start.end(), m.data.begin() + first );
+
+  bell *r = &m.data[first];
+  for ( vector<run>::const_iterator i( rs.begin() ), e( rs.end() ); 
+        i != e; ++i )
+    for ( size_t k = 0; k < i->reps; ++k )
+      for ( size_t c = i->begin; c != i->end; ++c, r += b ) {
+        bell const *p = &perms[ seq[c] * b ];
+        for ( int j = 0; j < b; ++j )
+          r[b+j] = r[ p[j] ];
+      }
+
+  row const last( vector<bell>( r, r+b ) );
+  m.data.resize( first + n*b );
+  return last;
+}
+
 
 RINGING_END_NAMESPACE
@@ -157,6 +157,8 @@ public:
   void pop_back() { ch.pop_back(); }
 };
 
+class compiled_touch;
+
 // A wrapper around a list of touch_nodes to manage their memory
 class RINGING_API touch
 {
@@ -176,6 +178,9 @@ public:
   const touch_node *get_head() const { return head; }
   touch_node *get_head() { return head; }
 
+  // Flatten the touch for faster iteration
+  compiled_touch compile() const;
+
   touch() : head(0) {}
  
   // Compiler-generated constructor triggers bug in gcc 4.0.1
@@ -186,6 +191,81 @@ private:
   vector< shared_pointer< touch_node > > nodes;
 };
 
+// Rows on the same number of bells, stored one after another in a 
+// single array
+class RINGING_API row_matrix
+{
+public:
+  explicit row_matrix( int bells = 0 ) : b( bells ) {}
+
+  int bells() const { return b; }
+  size_t size() const { return b ? data.size() / b : 0; }
+  bool empty() const { return data.empty(); }
+
+  // The bells of the ith row
+  const bell *operator[]( size_t i ) const { return &data[ i*b ]; }
+  row get_row( size_t i ) const 
+    { return row( vector<bell>( data.begin() + i*b, 
+                                data.begin() + (i+1)*b ) ); }
+
+  void push_back( const row &r ) 
+    { data.insert( data.end(), r.begin(), r.end() ); }
+  void clear() { data.clear(); }
+  void reserve( size_t n ) { data.reserve( n*b ); }
+
+private:
+  friend class compiled_touch;
+
+  int b;
+  vector<bell> data;
+};
+
+// A touch flattened into arrays.  Each distinct change is kept once, as
+// the permutation of positions that it makes, and the touch as a list of
+// runs of consecutive changes, each of which may be repeated.  A child
+// list entry that repeats a node more than once becomes one run, so the
+// changes of a touch written as "5 parts of ..." are only stored once.
+class RINGING_API compiled_touch
+{
+public:
+  // The changes sequence()[begin] to sequence()[end-1], reps times
+  struct run 
+  { 
+    run( size_t begin, size_t end, size_t reps ) 
+      : begin(begin), end(end), reps(reps) {}
+    size_t begin, end, reps; 
+  };
+
+  compiled_touch() : b(0), n(0) {}
+
+  int bells() const { return b; }
+  size_t size() const { return n; }  // The number of changes 
+
+  const vector<change> &changes() const { return chs; }
+  const vector<size_t> &sequence() const { return seq; }
+  const vector<run> &runs() const { return rs; }
+
+  // Appends the rows of the touch, starting from start, to m, and 
+  // returns the row reached by the last change, which is not appended.
+  // The start row and m must be on the same number of bells as the
+  // touch, though m may be empty and on none.
+  row rows( const row &start, row_matrix &m ) const;
+  row rows( row_matrix &m ) const { return rows( row(b), m ); }
+
+private:
+  class compiler;
+  friend class compiler;
+  friend class touch;
+
+  int b;                      // The number of bells
+  size_t n;                   // The number of changes
+  vector<change> chs;         // The distinct changes 
+  vector<bell> perms;         // perms[i*b + j] is the position moving to
+                              // j when chs[i] is rung
+  vector<size_t> seq;         // Indices into chs
+  vector<run> rs;
+};
+
 RINGING_END_NAMESPACE
 
 #endif
@@ -20,6 +20,15 @@
 #include <ringing/extent.h>
 #include <ringing/mathutils.h>
 #include "test-base.h"
+#if RINGING_OLD_INCLUDES
+#include <vector.h>
+#include <algo.h>
+#include <iterator.h>
+#else
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#endif
 
 RINGING_START_NAMESPACE
 
@@ -81,6 +90,116 @@ void test_extent_index(void)
       }
 }
 
+void test_extent_chunks(void)
+{
+  extent const ex(5, 1, 8);
+  vector<row> const v( ex.begin(), ex.end() );
+
+  for ( size_t n=1; n<=13; n+=4 ) 
+  {
+    vector<row> w;
+    for ( size_t k=0; k<n; ++k ) {
+      extent::chunk_type const c( ex.chunk(k, n) );
+      RINGING_TEST( c.offset() == w.size() );
+      RINGING_TEST( c.size() == ex.size() / n || c.size() == ex.size() / n + 1 );
+      if ( c.size() ) RINGING_TEST( c[c.size()-1] == v[ c.offset() + c.size()-1 ] );
+      copy( c.begin(), c.end(), back_inserter(w) );
+    }
+    RINGING_TEST( w == v );
+  }
+
+  RINGING_TEST( extent_iterator::at( 0, 5, 1, 8 ) == ex.begin() );
+  RINGING_TEST( extent_iterator::at( 120, 5, 1, 8 ) == ex.end() );
+}
+
+class check_row
+{
+public:
+  check_row( vector<row> const& v, vector<int>& seen ) : v(v), seen(seen) {}
+  void operator()( row const& r, size_t i ) const
+    { if ( r == v[i] ) ++seen[i]; }
+
+private:
+  vector<row> const& v;
+  vector<int>& seen;
+};
+
+void test_extent_parallel(void)
+{
+  extent const ex(6, 1);
+  vector<row> const v( ex.begin(), ex.end() );
+
+  for ( unsigned threads=0; threads<4; ++threads ) {
+    vector<int> seen( v.size() );
+    parallel_for_each_row( ex, check_row( v, seen ), threads );
+    RINGING_TEST( count( seen.begin(), seen.end(), 1 ) == int(v.size()) );
+  }
+}
+
+void test_incourse_extent(void)
+{
+  for ( unsigned nh=0; nh<3; ++nh )
+    for ( unsigned nw=0; nw<7; ++nw )
+      for ( unsigned nt=nh+nw; nt<nh+nw+2; ++nt )
+      {
+        vector<row> v;
+        for ( extent_iterator i(nw, nh, nt), e; i != e; ++i )
+          if ( i->sign() == +1 ) v.push_back(*i);
+
+        incourse_extent const ex(nw, nh, nt);
+        RINGING_TEST( ex.size() == v.size() );
+        RINGING_TEST( vector<row>( ex.begin(), ex.end() ) == v );
+
+        for ( size_t n=0; n<v.size(); ++n ) {
+          RINGING_TEST( ex[n] == v[n] );
+          RINGING_TEST( ex[v[n]] == n );
+        }
+
+        vector<row> w;
+        for ( size_t k=0; k<5; ++k ) {
+          incourse_extent::chunk_type const c( ex.chunk(k, 5) );
+          RINGING_TEST( c.offset() == w.size() );
+          copy( c.begin(), c.end(), back_inserter(w) );
+        }
+        RINGING_TEST( w == v );
+      }
+
+  incourse_extent const ex(6, 1);
+  vector<row> const v( ex.begin(), ex.end() );
+  vector<int> seen( v.size() );
+  parallel_for_each_row( ex, check_row( v, seen ), 3 );
+  RINGING_TEST( count( seen.begin(), seen.end(), 1 ) == int(v.size()) );
+}
+
+void test_plain_changes(void)
+{
+  for ( unsigned nh=0; nh<3; ++nh )
+    for ( unsigned nw=0; nw<7; ++nw )
+      for ( unsigned nt=nh+nw; nt<nh+nw+2; ++nt )
+      {
+        vector<row> v;
+        row r(nt);
+        for ( plain_changes_iterator i(nw, nh, nt), e; i != e; ++i ) {
+          RINGING_TEST( *i == r );
+          if ( nw > 1 ) 
+            RINGING_TEST( i->sign() == ( v.size() % 2 ? -1 : +1 ) );
+          v.push_back(*i);
+          r *= i.next_change();
+        }
+        RINGING_TEST( r == row::rounds(nt) );
+
+        vector<row> const w( extent_iterator(nw, nh, nt), extent_iterator() );
+        sort( v.begin(), v.end() );
+        RINGING_TEST( v == w );
+      }
+
+  plain_changes_iterator i(3);
+  RINGING_TEST( *i++ == "123" );  RINGING_TEST( *i++ == "132" );
+  RINGING_TEST( *i++ == "312" );  RINGING_TEST( *i++ == "321" );
+  RINGING_TEST( *i == "231" );  RINGING_TEST( i++.swap_position() == 1 );
+  RINGING_TEST( *i == "213" );  RINGING_TEST( i++.swap_position() == 0 );
+  RINGING_TEST( i == plain_changes_iterator() );
+}
 
 RINGING_END_ANON_NAMESPACE
   
@@ -89,6 +208,10 @@ RINGING_START_TEST_FILE( extent )
   RINGING_REGISTER_TEST( test_extent_length )
   RINGING_REGISTER_TEST( test_extent_fixed_bells )
   RINGING_REGISTER_TEST( test_extent_index )
+  RINGING_REGISTER_TEST( test_extent_chunks )
+  RINGING_REGISTER_TEST( test_extent_parallel )
+  RINGING_REGISTER_TEST( test_incourse_extent )
+  RINGING_REGISTER_TEST( test_plain_changes )
 
 RINGING_END_TEST_FILE
 
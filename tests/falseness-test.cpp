@@ -0,0 +1,338 @@
+// -*- C++ -*- falseness-test.cpp - Tests for the falseness table class
+// Copyright (C) 2014 Richard Smith <richard@ex-parrot.com>
+
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+// $Id$
+
+#include <ringing/falseness.h>
+#include <ringing/falseness_cache.h>
+#include <ringing/falseness_graph.h>
+#include <ringing/group.h>
+#include <ringing/mathutils.h>
+#include <ringing/method.h>
+#include <ringing/row.h>
+#include <ringing/extent.h>
+#include "test-base.h"
+#if RINGING_OLD_INCLUDES
+#include <set.h>
+#include <map.h>
+#include <vector.h>
+#else
+#include <set>
+#include <map>
+#include <vector>
+#endif
+#if RINGING_OLD_C_INCLUDES
+#include <stdio.h>
+#else
+#include <cstdio>
+#endif
+
+RINGING_START_NAMESPACE
+
+RINGING_USING_STD
+
+RINGING_START_ANON_NAMESPACE
+
+// The falseness table calculated in the obvious way
+vector<row> simple_falseness( vector<row> const& a, vector<row> const& b,
+                              int flags )
+{
+  size_t const 
+    n1( flags & falseness_table::half_lead_only ? a.size() / 2 : a.size() ),
+    n2( flags & falseness_table::half_lead_only ? b.size() / 2 : b.size() );
+
+  set<row> fs;
+  for ( size_t i=0; i<n1; ++i )
+    for ( size_t j=0; j<n2; ++j ) {
+      row const f( a[i] / b[j] );
+      if ( !( flags & falseness_table::no_fixed_treble ) && f[0] != 0 )
+        continue;
+      if ( ( flags & falseness_table::in_course_only ) && f.sign() == -1 )
+        continue;
+      if ( ( flags & falseness_table::out_of_course_only ) && f.sign() == +1 )
+        continue;
+      fs.insert(f);
+    }
+
+  return vector<row>( fs.begin(), fs.end() );
+}
+
+bool check_falseness( vector<row> const& a, vector<row> const& b, int flags )
+{
+  falseness_table const ft( a, b, flags );
+  return vector<row>( ft.begin(), ft.end() ) 
+    == simple_falseness( a, b, flags );
+}
+
+vector<row> lead( method const& m )
+{
+  return row_block( m, row_block::no_final_lead_head );
+}
+
+void test_falseness_methods(void)
+{
+  int const flags[] = { 
+    0, falseness_table::in_course_only, falseness_table::out_of_course_only,
+    falseness_table::no_fixed_treble, falseness_table::half_lead_only,
+    falseness_table::no_fixed_treble | falseness_table::in_course_only 
+  };
+
+  vector<row> const 
+    cm( lead( method( "&-36-14-12-36.14-14.36,12", 6 ) ) ),
+    bm( lead( method( "&-58-14.58-58.36.14-14.58-14-18,18", 8 ) ) ),
+    ym( lead( method( "&-38-14-1258-36-14-58-16-78,12", 8 ) ) ),
+    cx( lead( method( "&-3T-14-125T-36-147T-58-169T-70-18-9T-10-ET,12", 
+                      12 ) ) );
+
+  for ( size_t i=0; i<sizeof(flags)/sizeof(int); ++i ) {
+    RINGING_TEST( check_falseness( cm, cm, flags[i] ) );
+    RINGING_TEST( check_falseness( bm, bm, flags[i] ) );
+    RINGING_TEST( check_falseness( bm, ym, flags[i] ) );
+    RINGING_TEST( check_falseness( ym, bm, flags[i] ) );
+    RINGING_TEST( check_falseness( cx, cx, flags[i] ) );
+  }
+
+  falseness_table const ft( method( "&-58-14.58-58.36.14-14.58-14-18,18", 8 ) );
+  RINGING_TEST( vector<row>( ft.begin(), ft.end() ) 
+                == simple_falseness( bm, bm, 0 ) );
+}
+
+void test_falseness_large(void)
+{
+  // Enough products for the work to be split between threads
+  vector<row> a, b;
+  for ( int i=0; i<300; ++i ) {
+    a.push_back( random_row( 10 ) );
+    b.push_back( random_row( 10 ) );
+  }
+  RINGING_TEST( check_falseness( a, b, falseness_table::no_fixed_treble ) );
+  RINGING_TEST( check_falseness( a, a, falseness_table::no_fixed_treble 
+                                 | falseness_table::in_course_only ) );
+
+  // The largest number of bells that can be packed, and one more
+  vector<row> c, d;
+  for ( int i=0; i<50; ++i ) {
+    c.push_back( random_row( 16 ) );
+    d.push_back( random_row( 17 ) );
+  }
+  RINGING_TEST( check_falseness( c, c, falseness_table::no_fixed_treble ) );
+  RINGING_TEST( check_falseness( d, d, falseness_table::no_fixed_treble ) );
+
+  // Rows of different lengths
+  c.push_back( random_row( 12 ) );
+  RINGING_TEST( check_falseness( c, c, falseness_table::no_fixed_treble ) );
+}
+
+class check_pair : public falseness_matrix::pair_function
+{
+public:
+  check_pair( vector<method> const& m, int flags, vector<int>& seen ) 
+    : m(m), flags(flags), seen(seen) {}
+
+  virtual bool wanted( size_t i, size_t j ) const { return j != 1; }
+
+  virtual void operator()( size_t i, size_t j, falseness_table const& ft ) 
+  {
+    falseness_table const ft2( m[i], m[j], flags );
+    if ( vector<row>( ft.begin(), ft.end() ) 
+           == vector<row>( ft2.begin(), ft2.end() ) )
+      ++seen[ i * m.size() + j ];
+  }
+
+private:
+  vector<method> const& m;
+  int flags;
+  vector<int>& seen;
+};
+
+void test_falseness_matrix(void)
+{
+  vector<method> m;
+  m.push_back( method( "&-58-14.58-58.36.14-14.58-14-18,18", 8 ) );
+  m.push_back( method( "&-38-14-1258-36-14-58-16-78,12", 8 ) );
+  m.push_back( method( "&-5-4.5-5.36.4-4.5-4-1,8", 8 ) );
+  m.push_back( method( "&-56-14-56-38-14-58-14-58,12", 8 ) );
+  m.push_back( method( "&-36-14-58-36-14-58-36-78,12", 8 ) );
+  m.push_back( method( "&-1-1-1-1,2", 8 ) );
+  m.push_back( method( "&-58-14.58-58.36.14-14.58-14-18,12", 8 ) );
+
+  int const flags = falseness_table::in_course_only;
+  for ( size_t tile = 1; tile < 5; ++tile ) {
+    falseness_matrix fm( flags, tile );
+    for ( size_t i=0; i<m.size(); ++i ) 
+      RINGING_TEST( fm.push_back( m[i] ) == i );
+
+    falseness_table const ft( fm.table(1, 4) ), ft2( m[1], m[4], flags );
+    RINGING_TEST( vector<row>( ft.begin(), ft.end() ) 
+                  == vector<row>( ft2.begin(), ft2.end() ) );
+
+    vector<int> seen( m.size() * m.size() );
+    check_pair f( m, flags, seen );
+    fm.for_each_pair( 2, 5, f, 1 );
+    fm.for_each_pair( 5, m.size(), f );
+
+    for ( size_t i=0; i<m.size(); ++i )
+      for ( size_t j=0; j<m.size(); ++j )
+        RINGING_TEST( seen[ i * m.size() + j ] 
+                      == ( i >= 2 && j < i && j != 1 ? 1 : 0 ) );
+  }
+}
+
+void test_falseness_cache(void)
+{
+  method const bm( "&-58-14.58-58.36.14-14.58-14-18,18", 8 ),
+    ym( "&-38-14-1258-36-14-58-16-78,12", 8 );
+  int const fcflags = false_courses::in_course_only;
+  int const ftflags = falseness_table::in_course_only;
+  char const* const filename = "falseness-cache.tmp";
+  remove( filename );
+
+  {
+    falseness_cache c( filename );
+    false_courses fc;
+    RINGING_TEST( !c.lookup( bm, fcflags, fc ) );
+
+    false_courses const fc2( c.courses( bm, fcflags ) ), fc3( bm, fcflags );
+    RINGING_TEST( vector<row>( fc2.begin(), fc2.end() ) 
+                  == vector<row>( fc3.begin(), fc3.end() ) );
+    RINGING_TEST( c.symbols( bm, 0 ) == false_courses( bm, 0 ).symbols() );
+
+    c.table( bm, ym, ftflags );
+    RINGING_TEST( c.size() == 4 );
+  }
+
+  falseness_cache c( filename );
+  RINGING_TEST( c.size() == 4 );
+
+  false_courses fc;
+  RINGING_TEST( c.lookup( bm, fcflags, fc ) );
+  RINGING_TEST( fc.size() == false_courses( bm, fcflags ).size() );
+  RINGING_TEST( !c.lookup( ym, fcflags, fc ) );
+  RINGING_TEST( !c.lookup( bm, false_courses::tenors_together, fc ) );
+
+  string syms;
+  RINGING_TEST( c.lookup_symbols( bm, 0, syms ) 
+                && syms == false_courses( bm, 0 ).symbols() );
+
+  falseness_table ft, ft2( bm, ym, ftflags );
+  RINGING_TEST( c.lookup( bm, ym, ftflags, ft ) );
+  RINGING_TEST( vector<row>( ft.begin(), ft.end() ) 
+                == vector<row>( ft2.begin(), ft2.end() ) );
+  RINGING_TEST( !c.lookup( ym, bm, ftflags, ft ) );
+  RINGING_TEST( !c.lookup( bm, ftflags, ft ) );
+
+  remove( filename );
+}
+
+// Colour the component containing rounds the obvious way, returning
+// whether it is bipartite and setting n to its size.
+bool simple_bipartite( falseness_table const& ft, size_t& n )
+{
+  map<row, bool> colour;
+  vector<row> todo( 1, row(ft.begin()->bells()) );
+  colour[ todo.back() ] = false;
+  bool bipartite = true;
+
+  while ( !todo.empty() ) {
+    row const r( todo.back() ); todo.pop_back();
+    for ( falseness_table::const_iterator i=ft.begin(), e=ft.end(); 
+          i!=e; ++i ) {
+      if ( i->isrounds() ) continue;
+      row const s( r * *i );
+      if ( colour.find(s) == colour.end() ) {
+        colour[s] = !colour[r];
+        todo.push_back(s);
+      }
+      else if ( colour[s] == colour[r] )
+        bipartite = false;
+    }
+  }
+
+  n = colour.size();
+  return bipartite;
+}
+
+void test_falseness_graph(void)
+{
+  char const* const pns[] = { 
+    "&-36-14-12-36.14-14.36,12", "&-16-16-16,12", "&-16-16-16,16",
+    "&3-36.14-12-36.14-14.36,12", "&-36-14-12-36-14-56,12",
+    "&-38-14-1258-36-14-58-16-78,12", "&-58-14.58-58.36.14-14.58-14-18,18",
+    "&-18-18-18-18,12"
+  };
+
+  for ( size_t i=0; i<sizeof(pns)/sizeof(char const*); ++i ) {
+    int const b = i < 5 ? 6 : 8;
+    int const flags[] = { 0, falseness_table::in_course_only };
+    for ( size_t j=0; j<2; ++j ) {
+      falseness_table const ft( method( pns[i], b ), flags[j] );
+      falseness_graph const fg( ft );
+
+      size_t n;
+      bool const bipartite( simple_bipartite( ft, n ) );
+      RINGING_TEST( fg.bells() == b );
+      RINGING_TEST( fg.hunts() == 1 );
+      RINGING_TEST( fg.size() == factorial(b-1) );
+      RINGING_TEST( fg.is_bipartite() == bipartite );
+      RINGING_TEST( fg.component_size() == n );
+      RINGING_TEST( fg.component_size() == ft.generate_group().size() );
+      RINGING_TEST( fg.components() * n == fg.size() );
+    }
+  }
+}
+
+void test_falseness_splice_clusters(void)
+{
+  splice_clusters c;
+  c.join(5, 7);
+  c.join(1, 2);
+  c.join(7, 3);
+  c.join(9, 9);
+  c.join(2, 3);
+  c.join(4, 6);
+
+  RINGING_TEST( c.contains(9) && c.contains(4) );
+  RINGING_TEST( !c.contains(0) && !c.contains(8) && !c.contains(10) );
+  RINGING_TEST( c.find(1) == c.find(5) );
+  RINGING_TEST( c.find(4) == c.find(6) );
+  RINGING_TEST( c.find(1) != c.find(4) && c.find(1) != c.find(9) );
+
+  vector<size_t> const c1( c.cluster(3) );
+  size_t const e1[] = { 1, 2, 3, 5, 7 };
+  RINGING_TEST( c1 == vector<size_t>( e1, e1 + 5 ) );
+
+  vector< vector<size_t> > const cs( c.clusters() );
+  RINGING_TEST( cs.size() == 3 );
+  RINGING_TEST( cs.size() == 3 && cs[0] == c1 
+                && cs[1] == vector<size_t>( 1, 9 ) 
+                && cs[2].size() == 2 && cs[2][0] == 4 && cs[2][1] == 6 );
+}
+
+RINGING_END_ANON_NAMESPACE
+
+RINGING_START_TEST_FILE( falseness )
+
+  RINGING_REGISTER_TEST( test_falseness_methods )
+  RINGING_REGISTER_TEST( test_falseness_large )
+  RINGING_REGISTER_TEST( test_falseness_matrix )
+  RINGING_REGISTER_TEST( test_falseness_cache )
+  RINGING_REGISTER_TEST( test_falseness_graph )
+  RINGING_REGISTER_TEST( test_falseness_splice_clusters )
+
+RINGING_END_TEST_FILE
+
+RINGING_END_NAMESPACE
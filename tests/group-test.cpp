@@ -0,0 +1,192 @@
+// -*- C++ -*- group-test.cpp - Tests for the group and stabilizer chain classes
+// Copyright (C) 2014 Richard Smith <richard@ex-parrot.com>
+
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+// $Id$
+
+#include <ringing/group.h>
+#include <ringing/stabilizer_chain.h>
+#include <ringing/extent.h>
+#include <ringing/mathutils.h>
+#include "test-base.h"
+#if RINGING_OLD_INCLUDES
+#include <set.h>
+#include <algo.h>
+#else
+#include <set>
+#include <algorithm>
+#endif
+
+RINGING_START_NAMESPACE
+
+RINGING_USING_STD
+
+RINGING_START_ANON_NAMESPACE
+
+// The old way of generating a group: close the generators under
+// multiplication.
+set<row> close_group( vector<row> const& gens, int b )
+{
+  set<row> s;  s.insert( row(b) );
+  vector<row> x( 1u, row(b) );
+  while ( x.size() ) {
+    row r = x.back(); x.pop_back();
+    for ( vector<row>::const_iterator i=gens.begin(), e=gens.end(); i!=e; ++i )
+      if ( s.insert( r * *i ).second )
+        x.push_back( r * *i );
+  }
+  return s;
+}
+
+void test_group_elements(void)
+{
+  char const* const gen_strs[][2] = {
+    { "2314", "" },                   // C3
+    { "23456781", "" },               // C8
+    { "23456781", "87654321" },       // D8
+    { "13425678", "12345786" },       // C3 x C3
+    { "1243", "2134" },               // V4
+    { "234567891", "213456789" },     // S9
+    { "1342", "2143" }                // A4
+  };
+
+  for ( size_t i=0; i < sizeof(gen_strs)/sizeof(*gen_strs); ++i ) {
+    vector<row> gens;
+    gens.push_back( row( gen_strs[i][0] ) );
+    if ( *gen_strs[i][1] ) gens.push_back( row( gen_strs[i][1] ) );
+
+    int const b = gens.front().bells();
+    set<row> const s( close_group( gens, b ) );
+    group const g( gens );
+
+    RINGING_TEST( g.bells() == size_t(b) );
+    RINGING_TEST( g.size() == s.size() );
+    RINGING_TEST( g.get_chain().order() == s.size() );
+    RINGING_TEST( equal( s.begin(), s.end(), g.begin() ) );
+    RINGING_TEST( equal( s.begin(), s.end(), g.get_chain().begin() ) );
+
+    if ( b <= 6 )
+      for ( extent_iterator j(b), e; j != e; ++j )
+        RINGING_TEST( g.contains(*j) == ( s.find(*j) != s.end() ) );
+
+    for ( int j=0; j<20; ++j )
+      RINGING_TEST( s.find( g.random_element() ) != s.end() );
+  }
+}
+
+void test_group_named(void)
+{
+  RINGING_TEST( group::symmetric_group(5).size() == 120 );
+  RINGING_TEST( group::alternating_group(5).size() == 60 );
+  RINGING_TEST( group::symmetric_group(5, 1, 8).size() == 120 );
+  RINGING_TEST( group::alternating_group(1).size() == 1 );
+
+  // Groups too large to enumerate
+  RINGING_TEST( group::symmetric_group(12).size() == 479001600u );
+  RINGING_ULLONG f15 = 1307674368u;  f15 *= 1000u;
+  RINGING_TEST( group::symmetric_group(15, 1).get_chain().order() == f15 );
+
+  group const s8( group::symmetric_group(7, 1) );
+  RINGING_TEST( s8.contains( row("15738264") ) );
+  RINGING_TEST( !s8.contains( row("51738264") ) );
+  RINGING_TEST( group::alternating_group(7, 1).contains( row("13425678") ) );
+  RINGING_TEST( !group::alternating_group(7, 1).contains( row("13245678") ) );
+
+  vector<row> v( extent_iterator(4, 1), extent_iterator() );
+  group const s4( group::symmetric_group(4, 1) );
+  RINGING_TEST( equal( v.begin(), v.end(), s4.begin() ) );
+  RINGING_TEST( s4 == group( row("13245"), row("13452") ) );
+
+  // Stopping early once the order is known to be large enough
+  vector<row> gens;
+  gens.push_back( row("2345678901") );  gens.push_back( row("2134567890") );
+  group const s10( gens, 5040 );
+  RINGING_TEST( !s10.complete() && s10.size() >= 5040 );
+  RINGING_TEST( group( gens, 10000000 ).size() == 3628800 );
+  RINGING_TEST( group( gens, 10000000 ).complete() );
+
+  vector<row> a( incourse_extent_iterator(5), incourse_extent_iterator() );
+  group const a5( group::alternating_group(5) );
+  RINGING_TEST( a5.size() == a.size() );
+  RINGING_TEST( equal( a.begin(), a.end(), a5.begin() ) );
+}
+
+void test_group_compare(void)
+{
+  group const c3( row("23145") ), c3b( row("31245") );
+  group const d3( row("23145"), row("21345") );
+
+  RINGING_TEST( c3 == c3b );
+  RINGING_TEST( !(c3 < c3b) && !(c3b < c3) );
+  RINGING_TEST( c3 != d3 );
+  RINGING_TEST( (c3 < d3) != (d3 < c3) );
+  RINGING_TEST( (c3 < d3) == lexicographical_compare( c3.begin(), c3.end(),
+                                                      d3.begin(), d3.end() ) );
+
+  group const c3c( c3.conjugate( row("12354") ) );
+  RINGING_TEST( c3c == c3 );
+  group const c3d( c3.conjugate( row("14325") ) );
+  RINGING_TEST( c3d != c3 );
+  RINGING_TEST( c3d.contains( row("42135") ) );
+
+  RINGING_TEST( group() == group( vector<row>() ) );
+  RINGING_TEST( group().size() == 1 );
+}
+
+void test_group_coset_labels(void)
+{
+  char const* const gen_strs[][2] = {
+    { "13456782", "" },               // C7
+    { "13456782", "18765432" },       // D7
+    { "13425678", "12345786" },       // C3 x C3
+    { "1342", "2143" },               // A4
+    { "21436587", "13254768" },       // Generates D4 acting on pairs
+    { "1324", "" }                    // Fewer bells than the rows
+  };
+
+  group const s8( group::symmetric_group(8) );
+
+  for ( size_t i=0; i < sizeof(gen_strs)/sizeof(*gen_strs); ++i ) {
+    vector<row> gens;
+    gens.push_back( row( gen_strs[i][0] ) );
+    if ( *gen_strs[i][1] ) gens.push_back( row( gen_strs[i][1] ) );
+    group const g( gens );
+
+    for ( int j=0; j<200; ++j ) {
+      row const r( s8.random_element() );
+      row rl, ll;
+      for ( group::const_iterator k=g.begin(), e=g.end(); k!=e; ++k ) {
+        if ( rl.bells() == 0 || *k * r < rl ) rl = *k * r;
+        if ( ll.bells() == 0 || r * *k < ll ) ll = r * *k;
+      }
+      RINGING_TEST( g.rcoset_label(r) == rl );
+      RINGING_TEST( g.lcoset_label(r) == ll );
+    }
+  }
+}
+
+RINGING_END_ANON_NAMESPACE
+
+RINGING_START_TEST_FILE( group )
+
+  RINGING_REGISTER_TEST( test_group_elements )
+  RINGING_REGISTER_TEST( test_group_named )
+  RINGING_REGISTER_TEST( test_group_compare )
+  RINGING_REGISTER_TEST( test_group_coset_labels )
+
+RINGING_END_TEST_FILE
+
+RINGING_END_NAMESPACE
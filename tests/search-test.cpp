@@ -0,0 +1,708 @@
+// -*- C++ -*- search-test.cpp - Tests for the touch searches
+// Copyright (C) 2014 Richard Smith <richard@ex-parrot.com>
+
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+// $Id$
+
+#include <ringing/table_search.h>
+#include <ringing/basic_search.h>
+#include <ringing/spliced_search.h>
+#include <ringing/touch.h>
+#include <ringing/method.h>
+#include <ringing/group.h>
+#include <ringing/music.h>
+#include "test-base.h"
+#if RINGING_OLD_INCLUDES
+#include <vector.h>
+#include <string.h>
+#include <algo.h>
+#include <set.h>
+#else
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <set>
+#endif
+#if RINGING_OLD_C_INCLUDES
+#include <limits.h>
+#else
+#include <climits>
+#endif
+
+RINGING_START_NAMESPACE
+
+RINGING_USING_STD
+
+RINGING_START_ANON_NAMESPACE
+
+// Collects the place notation of each touch found
+class touch_collector : public search_base::outputer
+{
+public:
+  explicit touch_collector( size_t limit = size_t(-1) ) : limit(limit) {}
+
+  virtual bool operator()( const touch &t )
+  {
+    string s;
+    for ( touch::const_iterator i( t.begin() ), e( t.end() ); i != e; ++i )
+      s += i->print() + '.';
+    touches.push_back(s);
+    return touches.size() >= limit;
+  }
+
+  // Record each checkpoint with the number of touches output before it
+  virtual void checkpoint( const search_base::position &p )
+  {
+    checkpoints.push_back( make_pair( p, touches.size() ) );
+  }
+
+  vector<string> touches;
+  vector< pair< search_base::position, size_t > > checkpoints;
+
+private:
+  size_t limit;
+};
+
+vector<string> search( table_search const& s, unsigned threads, 
+                       bool in_order, size_t limit = size_t(-1) )
+{
+  touch_collector c( limit );
+  s.run( c, threads, in_order );
+  return c.touches;
+}
+
+void test_search_parallel(void)
+{
+  vector<change> calls;
+  calls.push_back( change( 6, "14" ) );
+  calls.push_back( change( 6, "1234" ) );
+
+  table_search s( method( "&-16-16-16,12", 6 ), calls, group( row(6) ),
+                  make_pair( size_t(0), size_t(240) ), 
+                  table_search::length_in_changes );
+
+  vector<string> const seq( search( s, 1, false ) );
+  RINGING_TEST( seq.size() > 100 );
+
+  s.set_task_depth( 3 );
+  RINGING_TEST( search( s, 3, true ) == seq );
+  RINGING_TEST( search( s, 3, true, 10 ) 
+                == vector<string>( seq.begin(), seq.begin() + 10 ) );
+
+  vector<string> par( search( s, 3, false ) ), sorted( seq );
+  sort( par.begin(), par.end() );  sort( sorted.begin(), sorted.end() );
+  RINGING_TEST( par == sorted );
+  RINGING_TEST( search( s, 3, false, 10 ).size() == 10 );
+
+  // Split deeper than the longest touch
+  s.set_task_depth( 30 );
+  RINGING_TEST( search( s, 2, true ) == seq );
+
+  // A multi-part search
+  calls.pop_back();
+  table_search m( method( "&-58-14.58-58.36.14-14.58-14-18,18", 8 ), calls,
+                  group( row( "13425678" ) ), 
+                  make_pair( size_t(0), size_t(1536) ),
+                  table_search::length_in_changes );
+  vector<string> const mseq( search( m, 1, false ) );
+  RINGING_TEST( !mseq.empty() );
+  RINGING_TEST( search( m, 2, true ) == mseq );
+}
+
+void test_search_basic(void)
+{
+  vector<change> calls;
+  calls.push_back( change( 8, "14" ) );
+  calls.push_back( change( 8, "1234" ) );
+
+  // basic_search finds the same touches as table_search, though not 
+  // in the same order, and it repeats some rotations of periodic touches
+  method const m( "&-38-14-1258-36-14-58-16-78,12", 8 );
+  basic_search b( m, calls, make_pair( size_t(0), size_t(12) ) );
+  table_search t( m, calls, group( row(8) ), 
+                  make_pair( size_t(0), size_t(12) ) );
+
+  touch_collector bc;  b.run( bc );
+  vector<string> &bt = bc.touches, tt( search( t, 1, false ) );
+  RINGING_TEST( bt.size() > 100 );
+  sort( bt.begin(), bt.end() );  sort( tt.begin(), tt.end() );
+  bt.erase( unique( bt.begin(), bt.end() ), bt.end() );
+  RINGING_TEST( bt == tt );
+}
+
+vector<string> search_range( table_search s, string const& first, 
+                             string const& last, unsigned threads = 1 )
+{
+  s.set_range( search_base::parse_position( first ),
+               search_base::parse_position( last ) );
+  return search( s, threads, true );
+}
+
+void test_search_range(void)
+{
+  search_base::position p;
+  p.push_back(3);  p.push_back(0);  p.push_back(12);
+  RINGING_TEST( search_base::format_position(p) == "3.0.12" );
+  RINGING_TEST( search_base::parse_position("3.0.12") == p );
+  RINGING_TEST( search_base::parse_position("").empty() );
+  RINGING_TEST_THROWS( search_base::parse_position("3..1"), runtime_error );
+  RINGING_TEST_THROWS( search_base::parse_position("1.x"), runtime_error );
+
+  vector<change> calls;
+  calls.push_back( change( 6, "14" ) );
+  calls.push_back( change( 6, "1234" ) );
+
+  table_search s( method( "&-16-16-16,12", 6 ), calls, group( row(6) ),
+                  make_pair( size_t(0), size_t(240) ), 
+                  table_search::length_in_changes );
+
+  vector<string> const seq( search( s, 1, false ) );
+  RINGING_TEST( search_range( s, "", "" ) == seq );
+
+  // Splitting the search at any position loses and repeats nothing
+  char const* const splits[] = { "1", "0.2", "0.0.0.1", "2.2.2", "0.1.2.0" };
+  for ( size_t i = 0; i < sizeof(splits)/sizeof(*splits); ++i ) {
+    vector<string> a( search_range( s, "", splits[i] ) ),
+      b( search_range( s, splits[i], "" ) );
+    a.insert( a.end(), b.begin(), b.end() );
+    RINGING_TEST( a == seq );
+  }
+
+  vector<string> a( search_range( s, "", "0.1" ) ), 
+    b( search_range( s, "0.1", "1.0.2" ) ), 
+    c( search_range( s, "1.0.2", "" ) );
+  RINGING_TEST( !a.empty() && !b.empty() && !c.empty() );
+  a.insert( a.end(), b.begin(), b.end() );
+  a.insert( a.end(), c.begin(), c.end() );
+  RINGING_TEST( a == seq );
+
+  // Ranges searched on several threads
+  s.set_task_depth( 4 );
+  RINGING_TEST( search_range( s, "0.1", "1.0.2", 3 ) == b );
+
+  // Resuming from each checkpoint finds the rest of the touches
+  touch_collector col;
+  s.run( col, 2, true );
+  RINGING_TEST( col.touches == seq );
+  RINGING_TEST( !col.checkpoints.empty() );
+  for ( size_t i = 0; i < col.checkpoints.size(); i += 7 ) {
+    table_search r( s );
+    r.set_range( col.checkpoints[i].first );
+    RINGING_TEST( search( r, 1, false ) 
+                  == vector<string>( seq.begin() + col.checkpoints[i].second,
+                                     seq.end() ) );
+  }
+}
+
+// Collects the touches found as sequences of call numbers, with 0 
+// being a plain lead
+class call_collector : public search_base::outputer
+{
+public:
+  call_collector( const method &m, const vector<change> &calls ) 
+    : len( m.size() ), lead_ends( 1, m.back() )
+  { 
+    lead_ends.insert( lead_ends.end(), calls.begin(), calls.end() ); 
+  }
+
+  virtual bool operator()( const touch &t )
+  {
+    vector<size_t> c;  size_t i = 0;
+    for ( touch::const_iterator j( t.begin() ), e( t.end() ); j != e; ++j )
+      if ( ++i % len == 0 )
+        c.push_back( find( lead_ends.begin(), lead_ends.end(), *j ) 
+                     - lead_ends.begin() );
+    touches.push_back(c);
+    return false;
+  }
+
+  size_t len;
+  vector<change> lead_ends;
+  vector< vector<size_t> > touches;
+};
+
+bool normalises( const group &g, const row &r )
+{
+  for ( vector<row>::const_iterator i( g.generators().begin() ); 
+        i != g.generators().end(); ++i )
+    if ( !g.contains( r.inverse() * *i * r ) )
+      return false;
+  return true;
+}
+
+// The least image of a touch under the rotations that start at a lead
+// head normalising the part ends, and optionally under reversal and 
+// the permutation of calls, perm.
+vector<size_t> least_image( const vector<size_t> &t, const method &m, 
+                            const vector<change> &lead_ends, const group &g,
+                            bool reversals, const vector<size_t> &perm )
+{
+  row const le( m.lh() * m.back() );
+  vector<size_t> least( t );
+  for ( int rev = 0; rev < (reversals ? 2 : 1); ++rev ) 
+    for ( int p = 0; p < (perm.empty() ? 1 : 2); ++p ) {
+      vector<size_t> s( t );
+      if ( rev ) reverse( s.begin(), s.end() );
+      if ( p ) 
+        for ( size_t i = 0; i < s.size(); ++i ) s[i] = perm[ s[i] ];
+
+      row r( m.bells() );
+      for ( size_t j = 0; j < s.size(); r = r * le * lead_ends[ s[j++] ] )
+        if ( normalises( g, r ) ) {
+          vector<size_t> u( s.begin() + j, s.end() );
+          u.insert( u.end(), s.begin(), s.begin() + j );
+          least = min( least, u );
+        }
+    }
+  return least;
+}
+
+// Check that a search pruning symmetries finds one touch from each 
+// class of those found by a search that does not
+void check_symmetries( const method &m, const vector<change> &calls, 
+                       const group &g, size_t len, int sym, 
+                       const vector<size_t> &perm = vector<size_t>() )
+{
+  table_search::flags const f = table_search::length_in_changes;
+  call_collector all( m, calls ), pruned( m, calls );
+  table_search( m, calls, g, make_pair( size_t(0), len ), f ).run( all );
+  table_search( m, calls, g, make_pair( size_t(0), len ), 
+                table_search::flags( f | sym ) ).run( pruned );
+
+  vector< vector<size_t> > classes;
+  for ( size_t i = 0; i < all.touches.size(); ++i ) 
+    classes.push_back( least_image( all.touches[i], m, all.lead_ends, g,
+                                    sym & table_search::ignore_reversals,
+                                    perm ) );
+  sort( classes.begin(), classes.end() );
+  classes.erase( unique( classes.begin(), classes.end() ), classes.end() );
+
+  sort( pruned.touches.begin(), pruned.touches.end() );
+  RINGING_TEST( !pruned.touches.empty() );
+  RINGING_TEST( pruned.touches.size() < all.touches.size() );
+  RINGING_TEST( pruned.touches == classes );
+}
+
+void test_search_symmetry(void)
+{
+  vector<change> calls;
+  calls.push_back( change( 6, "14" ) );
+  calls.push_back( change( 6, "1234" ) );
+
+  method const bob6( "&-16-16-16,12", 6 );
+  check_symmetries( bob6, calls, group( row(6) ), 168, 
+                    table_search::ignore_rotations );
+  check_symmetries( bob6, calls, group( row(6) ), 168, 
+                    table_search::ignore_rotations 
+                    | table_search::ignore_reversals );
+
+  // Three- and five-part touches whose part ends are normalised by the
+  // lead end, 15372846, so that their reversals have the same part ends
+  calls.assign( 1, change( 8, "14" ) );
+  calls.push_back( change( 8, "1234" ) );
+  method const yorkshire8( "&-38-14-1258-36-14-58-16-78,12", 8 );
+  check_symmetries( yorkshire8, calls, group( row("13542678") ), 1536,
+                    table_search::ignore_rotations );
+  check_symmetries( yorkshire8, calls, group( row("13542678") ), 1536,
+                    table_search::ignore_rotations 
+                    | table_search::ignore_reversals );
+  check_symmetries( yorkshire8, calls, group( row("13527648") ), 2560,
+                    table_search::ignore_rotations 
+                    | table_search::ignore_reversals );
+
+  // A bob at the lead end of Plain Bob Minor without a fixed treble is
+  // 56, which is the conjugate of a plain lead by 654321
+  calls.assign( 1, change( 6, "56" ) );
+  vector<size_t> perm;  perm.push_back(1);  perm.push_back(0);
+  check_symmetries( bob6, calls, group( row(6) ), 360, 
+                    table_search::ignore_rotations 
+                    | table_search::ignore_conjugates, perm );
+  check_symmetries( bob6, calls, group( row(6) ), 360, 
+                    table_search::ignore_rotations 
+                    | table_search::ignore_reversals
+                    | table_search::ignore_conjugates, perm );
+}
+
+// Records the statistics passed to it
+class statistics_collector : public search_base::outputer
+{
+public:
+  statistics_collector() : found(0), reports(0) {}
+
+  virtual bool operator()( const touch & ) { ++found; return false; }
+
+  virtual void progress( const search_base::statistics &s ) 
+    { ++reports; last = s; }
+
+  size_t found, reports;
+  search_base::statistics last;
+};
+
+search_base::statistics 
+run_statistics( const search_base &s, unsigned threads = 1 )
+{
+  statistics_collector c;
+  s.run( c, threads, false );
+  RINGING_TEST( c.reports > 0 );
+  RINGING_TEST( c.last.touches == c.found );
+  return c.last;
+}
+
+void test_search_statistics(void)
+{
+  vector<change> calls;
+  calls.push_back( change( 6, "14" ) );
+  calls.push_back( change( 6, "1234" ) );
+
+  table_search s( method( "&-16-16-16,12", 6 ), calls, group( row(6) ),
+                  make_pair( size_t(0), size_t(120) ), 
+                  table_search::length_in_changes );
+
+  // No progress reports unless asked for
+  statistics_collector none;
+  s.run( none );
+  RINGING_TEST( none.reports == 0 );
+
+  s.set_progress_interval( 1e-6 );
+  search_base::statistics const st( run_statistics( s ) );
+  RINGING_TEST( st.touches == none.found );
+  RINGING_TEST( st.nodes > st.false_nodes + st.non_canonical + st.too_long );
+  RINGING_TEST( st.false_nodes > 0 );
+  RINGING_TEST( st.non_canonical > 0 && st.too_long > 0 );
+  RINGING_TEST( st.depths.size() == 11 );
+  RINGING_TEST( st.depths[0] == 1 && st.depths[1] == 3 );
+
+  RINGING_ULLONG total = 0;
+  for ( size_t i = 0; i < st.depths.size(); ++i ) total += st.depths[i];
+  RINGING_TEST( total == st.nodes );
+
+  // Knuth's estimate should be in the right ballpark
+  RINGING_TEST( st.estimated_nodes > st.nodes / 4 
+                && st.estimated_nodes < st.nodes * 4 );
+
+  // Each node is counted once however the tree is split up
+  s.set_task_depth( 3 );
+  search_base::statistics const par( run_statistics( s, 3 ) );
+  RINGING_TEST( par.nodes == st.nodes && par.touches == st.touches );
+  RINGING_TEST( par.false_nodes == st.false_nodes );
+  RINGING_TEST( par.non_canonical == st.non_canonical );
+  RINGING_TEST( par.depths == st.depths );
+
+  s.set_range( search_base::position(), 
+               search_base::parse_position( "0.1.2" ) );
+  search_base::statistics const a( run_statistics( s ) );
+  s.set_range( search_base::parse_position( "0.1.2" ) );
+  search_base::statistics b( run_statistics( s ) );
+  RINGING_TEST( a.nodes > 0 && b.nodes > 0 );
+  b += a;
+  RINGING_TEST( b.nodes == st.nodes && b.depths == st.depths );
+  RINGING_TEST( b.touches == st.touches );
+}
+
+// Collects the call sequences passed to it
+class sequence_collector : public search_base::outputer
+{
+public:
+  sequence_collector() : built(0) {}
+
+  virtual bool operator()( const touch & ) { ++built; return false; }
+
+  virtual bool operator()( const search_base::call_sequence &c )
+  {
+    touches.push_back( vector<size_t>( c.begin(), c.end() ) );
+    parts.push_back( c.parts() );
+    scores.push_back( c.score() );
+    return false;
+  }
+
+  size_t built;
+  vector< vector<size_t> > touches;
+  vector< unsigned > parts;
+  vector< int > scores;
+};
+
+void check_call_sequences( const table_search &s, const method &m,
+                           const vector<change> &calls )
+{
+  sequence_collector sc;
+  s.run( sc );
+  RINGING_TEST( sc.built == 0 && !sc.touches.empty() );
+
+  // The same touches are built from the call sequences when asked for
+  call_collector cc( m, calls );
+  s.run( cc );
+  RINGING_TEST( cc.touches == sc.touches );
+
+  vector<row> lead_heads;
+  for ( size_t i = 0; i < cc.lead_ends.size(); ++i ) {
+    method lead( m );  lead.back() = cc.lead_ends[i];
+    lead_heads.push_back( lead.lh() );
+  }
+
+  for ( size_t i = 0; i < sc.touches.size(); ++i ) {
+    row r( m.bells() );
+    for ( size_t j = 0; j < sc.touches[i].size(); ++j )
+      r *= lead_heads[ sc.touches[i][j] ];
+    RINGING_TEST( r.order() == int( sc.parts[i] ) );
+  }
+}
+
+void test_search_call_sequence(void)
+{
+  vector<change> calls;
+  calls.push_back( change( 6, "14" ) );
+  calls.push_back( change( 6, "1234" ) );
+
+  method const m( "&-16-16-16,12", 6 );
+  table_search s( m, calls, group( row(6) ),
+                  make_pair( size_t(0), size_t(120) ), 
+                  table_search::length_in_changes );
+  check_call_sequences( s, m, calls );
+
+  table_search nr( m, calls, group( row(6) ),
+                   make_pair( size_t(0), size_t(72) ), 
+                   static_cast<table_search::flags>
+                     ( table_search::length_in_changes 
+                       | table_search::non_round_blocks ) );
+  check_call_sequences( nr, m, calls );
+
+  calls.pop_back();
+  method const bristol( "&-58-14.58-58.36.14-14.58-14-18,18", 8 );
+  table_search mp( bristol, calls, group( row( "13425678" ) ), 
+                   make_pair( size_t(0), size_t(1536) ),
+                   table_search::length_in_changes );
+  check_call_sequences( mp, bristol, calls );
+}
+
+// The score of a round block of the method given by its call numbers
+int touch_score( const method &m, const vector<change> &calls, 
+                 music mus, const vector<size_t> &t )
+{
+  mus.reset_music();
+  row r( m.bells() );  bool back = false;
+  do for ( size_t i = 0; i < t.size(); ++i )
+    for ( size_t j = 0; j < m.size(); ++j, back = !back ) {
+      mus.process_row( r, back );
+      r *= j+1 < m.size() ? m[j] : t[i] ? calls[ t[i]-1 ] : m.back();
+    }
+  while ( !r.isrounds() );
+  return mus.get_score();
+}
+
+typedef pair< int, vector<size_t> > scored;
+
+// Better touches come first
+bool by_score( const scored &a, const scored &b )
+{
+  return a.first > b.first || a.first == b.first && a.second < b.second;
+}
+
+// Check a scored search finds the best touches found by an unscored one
+void check_music( table_search s, const method &m, 
+                  const vector<change> &calls, const music &mus, 
+                  size_t best, int min_score, unsigned threads = 1 )
+{
+  call_collector all( m, calls );
+  s.run( all );
+
+  vector< scored > expected;
+  for ( size_t i = 0; i < all.touches.size(); ++i ) {
+    int const score = touch_score( m, calls, mus, all.touches[i] );
+    if ( score >= min_score )
+      expected.push_back( make_pair( score, all.touches[i] ) );
+  }
+  sort( expected.begin(), expected.end(), by_score );
+  if ( best && expected.size() > best ) 
+    expected.resize( best );
+
+  s.set_music( mus, best, min_score );
+  sequence_collector sc;
+  s.run( sc, threads );
+  RINGING_TEST( sc.built == 0 );
+
+  vector< scored > found;
+  for ( size_t i = 0; i < sc.touches.size(); ++i )
+    found.push_back( make_pair( sc.scores[i], sc.touches[i] ) );
+  RINGING_TEST( found == expected );
+}
+
+void test_search_music(void)
+{
+  vector<change> calls;
+  calls.push_back( change( 6, "14" ) );
+  calls.push_back( change( 6, "1234" ) );
+
+  music mus( 6 );
+  add_scored_music_string( mus, "<4-runs>" );
+  add_scored_music_string( mus, "2:*56" );
+  add_scored_music_string( mus, "-3:*65" );
+
+  method const m( "&-16-16-16,12", 6 );
+  table_search s( m, calls, group( row(6) ),
+                  make_pair( size_t(0), size_t(144) ), 
+                  table_search::length_in_changes );
+  check_music( s, m, calls, mus, 10, INT_MIN );
+  check_music( s, m, calls, mus, 1, INT_MIN );
+  check_music( s, m, calls, mus, 0, 20 );
+  check_music( s, m, calls, mus, 1000000, 0 );
+
+  // The best are chosen in the same way on several threads
+  s.set_task_depth( 3 );
+  check_music( s, m, calls, mus, 25, INT_MIN, 3 );
+
+  table_search r( m, calls, group( row(6) ),
+                  make_pair( size_t(0), size_t(144) ), 
+                  static_cast<table_search::flags>
+                    ( table_search::length_in_changes 
+                      | table_search::ignore_rotations ) );
+  check_music( r, m, calls, mus, 10, INT_MIN );
+
+  calls.pop_back();
+  method const bristol( "&-58-14.58-58.36.14-14.58-14-18,18", 8 );
+  music mus8( 8 );
+  add_scored_music_string( mus8, "<4-runs>" );
+  add_scored_music_string( mus8, "<CRUs>" );
+  table_search mp( bristol, calls, group( row( "13425678" ) ), 
+                   make_pair( size_t(0), size_t(1536) ),
+                   table_search::length_in_changes );
+  check_music( mp, bristol, calls, mus8, 5, INT_MIN );
+}
+
+// Collects the methods and calls of each lead of each touch
+class spliced_collector : public search_base::outputer
+{
+public:
+  virtual bool operator()( const touch & ) { return false; }
+
+  virtual bool operator()( const search_base::call_sequence &c )
+  {
+    vector< pair<size_t, size_t> > t;
+    for ( size_t i = 0; i < c.size(); ++i )
+      t.push_back( make_pair( c.method_index(i), c[i] ) );
+    touches.push_back(t);
+    return false;
+  }
+
+  vector< vector< pair<size_t, size_t> > > touches;
+};
+
+// Every round block of the methods of exactly len leads that is true
+set< vector< pair<size_t, size_t> > > 
+all_spliced( const vector<method> &meths, const vector<change> &calls, 
+             size_t len )
+{
+  size_t const n = meths.size() * ( calls.size() + 1 );
+  size_t total = 1;
+  for ( size_t i = 0; i < len; ++i ) total *= n;
+
+  set< vector< pair<size_t, size_t> > > found;
+  for ( size_t x = 0; x < total; ++x ) {
+    vector< pair<size_t, size_t> > t;
+    for ( size_t i = 0, y = x; i < len; ++i, y /= n )
+      t.push_back( make_pair( y % n / ( calls.size() + 1 ), 
+                              y % ( calls.size() + 1 ) ) );
+
+    set<row> rows;  row r( meths[0].bells() );  bool ok = true;
+    for ( size_t i = 0; ok && i < len; ++i ) {
+      method const& m = meths[ t[i].first ];
+      for ( size_t j = 0; ok && j < m.size(); ++j ) {
+        ok = rows.insert(r).second;
+        r *= j+1 < m.size() ? m[j] : t[i].second ? calls[ t[i].second-1 ] 
+                                                 : m.back();
+      }
+    }
+    if ( ok && r.isrounds() ) found.insert(t);
+  }
+  return found;
+}
+
+void test_search_spliced(void)
+{
+  vector<change> calls;
+  calls.push_back( change( 6, "14" ) );
+  calls.push_back( change( 6, "1234" ) );
+
+  // With one method, the same touches are found as by table_search
+  vector<method> meths( 1, method( "&-16-16-16,12", 6 ) );
+  {
+    spliced_search s( meths, calls, group( row(6) ),
+                      make_pair( size_t(0), size_t(120) ), 
+                      spliced_search::length_in_changes );
+    table_search t( meths[0], calls, group( row(6) ),
+                    make_pair( size_t(0), size_t(120) ), 
+                    table_search::length_in_changes );
+    sequence_collector a, b;  s.run(a);  t.run(b);
+    RINGING_TEST( a.built == 0 && !a.touches.empty() );
+    RINGING_TEST( a.touches == b.touches && a.parts == b.parts );
+  }
+
+  meths.push_back( method( "&-16-14-16,12", 6 ) );
+  meths.push_back( method( "&-36-14-12-36-14-56,12", 6 ) );
+  for ( size_t len = 1; len <= 5; ++len ) {
+    spliced_search s( meths, calls, group( row(6) ), make_pair( len, len ) );
+    spliced_collector c;  s.run(c);
+    set< vector< pair<size_t, size_t> > > 
+      found( c.touches.begin(), c.touches.end() );
+    RINGING_TEST( found.size() == c.touches.size() );
+    RINGING_TEST( found == all_spliced( meths, calls, len ) );
+  }
+
+  {
+    spliced_search s( meths, calls, group( row(6) ), 
+                      make_pair( size_t(0), size_t(6) ) );
+    s.set_changes_of_method( 2, 2 );
+    spliced_collector c;  s.run(c);
+    RINGING_TEST( !c.touches.empty() );
+    for ( size_t i = 0; i < c.touches.size(); ++i ) {
+      vector< pair<size_t, size_t> > const& t = c.touches[i];
+      size_t com = 0;
+      for ( size_t j = 0; j < t.size(); ++j )
+        if ( t[j].first != t[ (j+1) % t.size() ].first ) ++com;
+      RINGING_TEST( com == 2 );
+    }
+  }
+
+  // And likewise for a multipart
+  calls.pop_back();
+  vector<method> bristol
+    ( 1, method( "&-58-14.58-58.36.14-14.58-14-18,18", 8 ) );
+  spliced_search s( bristol, calls, group( row( "13425678" ) ), 
+                    make_pair( size_t(0), size_t(1536) ),
+                    spliced_search::length_in_changes );
+  table_search t( bristol[0], calls, group( row( "13425678" ) ), 
+                  make_pair( size_t(0), size_t(1536) ),
+                  table_search::length_in_changes );
+  sequence_collector a, b;  s.run(a);  t.run(b);
+  RINGING_TEST( !a.touches.empty() );
+  RINGING_TEST( a.touches == b.touches && a.parts == b.parts );
+}
+
+RINGING_END_ANON_NAMESPACE
+
+RINGING_START_TEST_FILE( search )
+
+  RINGING_REGISTER_TEST( test_search_parallel )
+  RINGING_REGISTER_TEST( test_search_basic )
+  RINGING_REGISTER_TEST( test_search_range )
+  RINGING_REGISTER_TEST( test_search_symmetry )
+  RINGING_REGISTER_TEST( test_search_statistics )
+  RINGING_REGISTER_TEST( test_search_call_sequence )
+  RINGING_REGISTER_TEST( test_search_music )
+  RINGING_REGISTER_TEST( test_search_spliced )
+
+RINGING_END_TEST_FILE
+
+RINGING_END_NAMESPACE
@@ -0,0 +1,119 @@
+// -*- C++ -*- touch-test.cpp - Tests for the touch classes
+// Copyright (C) 2014 Richard Smith <richard@ex-parrot.com>
+
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+// $Id$
+
+#include <ringing/touch.h>
+#include <ringing/method.h>
+#include "test-base.h"
+#if RINGING_OLD_INCLUDES
+#include <vector.h>
+#else
+#include <vector>
+#endif
+
+RINGING_START_NAMESPACE
+
+RINGING_USING_STD
+
+RINGING_START_ANON_NAMESPACE
+
+// Checks that the compiled touch has the same changes and rows as t
+void check_compiled( const touch &t, const row &start )
+{
+  compiled_touch const ct( t.compile() );
+
+  vector<change> expected( t.begin(), t.end() ), got;
+  for ( vector<compiled_touch::run>::const_iterator 
+          i( ct.runs().begin() ), e( ct.runs().end() ); i != e; ++i )
+    for ( size_t k = 0; k < i->reps; ++k )
+      for ( size_t c = i->begin; c != i->end; ++c )
+        got.push_back( ct.changes()[ ct.sequence()[c] ] );
+  RINGING_TEST( got == expected );
+  RINGING_TEST( ct.size() == expected.size() );
+
+  // Rows are appended after any already there
+  row_matrix m( start.bells() );  m.push_back( start );
+  row const last( ct.rows( start, m ) );
+  RINGING_TEST( m.size() == expected.size() + 1 );
+  RINGING_TEST( m.get_row(0) == start );
+
+  row r( start );
+  for ( size_t i = 0; i < expected.size(); ++i ) {
+    RINGING_TEST( m.get_row( i+1 ) == r );
+    RINGING_TEST( m[i+1][0] == r[0] );
+    r *= expected[i];
+  }
+  RINGING_TEST( last == r );
+}
+
+void test_touch_compile(void)
+{
+  touch t;
+  RINGING_TEST( t.compile().size() == 0 );
+
+  touch_changes *lead, *plain, *bob;
+  t.push_back( lead  = new touch_changes( "&-3-4-2-3-4-5", 6 ) );
+  t.push_back( plain = new touch_changes( "2", 6 ) );
+  t.push_back( bob   = new touch_changes( "4", 6 ) );
+
+  touch_child_list *p, *b, *part, *head;
+  t.push_back( p    = new touch_child_list );
+  t.push_back( b    = new touch_child_list );
+  t.push_back( part = new touch_child_list );
+  t.push_back( head = new touch_child_list );
+
+  p->push_back( 1, lead );  p->push_back( 1, plain );
+  b->push_back( 1, lead );  b->push_back( 1, bob );
+  part->push_back( 2, p );  part->push_back( 1, b );
+  head->push_back( 3, part );
+  t.set_head( head );
+
+  check_compiled( t, row(6) );
+  check_compiled( t, row("654321") );
+
+  // The part is held once, repeated three times
+  compiled_touch const ct( t.compile() );
+  RINGING_TEST( ct.size() == 3 * 72 );
+  RINGING_TEST( ct.runs().size() == 1 && ct.runs()[0].reps == 3 );
+  RINGING_TEST( ct.sequence().size() == 72 );
+  RINGING_TEST( ct.changes().size() == 5 );
+
+  // Repeated nodes next to ones that are not, and nested repeats
+  head->pop_back();
+  head->push_back( 1, lead );  head->push_back( 3, p );
+  head->push_back( 1, b );     head->push_back( 2, part );
+  head->push_back( 4, plain );
+  check_compiled( t, row(6) );
+  RINGING_TEST( t.compile().runs().back().reps == 4 );
+
+  // Changes on fewer bells than the touch leave the back bells alone
+  t.push_back( lead = new touch_changes( "x18x18", 8 ) );
+  head->push_back( 1, lead );
+  check_compiled( t, row(8) );
+  RINGING_TEST( t.compile().bells() == 8 );
+}
+
+RINGING_END_ANON_NAMESPACE
+
+RINGING_START_TEST_FILE( touch )
+
+  RINGING_REGISTER_TEST( test_touch_compile )
+
+RINGING_END_TEST_FILE
+
+RINGING_END_NAMESPACE